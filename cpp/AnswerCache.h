@@ -0,0 +1,246 @@
+#ifndef MUTUA_EVENTS_ANSWERCACHE_H_
+#define MUTUA_EVENTS_ANSWERCACHE_H_
+
+#include <mutex>
+#include <chrono>
+#include <functional>
+using namespace std;
+
+
+namespace mutua::events {
+
+	/**
+     * AnswerCache.h
+     * =============
+     *
+     * A bounded, concurrent memo of answers, keyed by the event parameter, to be placed in front of the answerfull consumers of a
+     * 'QueueEventLink' -- as in README's point 3, where not all 'n' simultaneous requests should hit the database:
+     *
+     *     AnswerCache<string, Record, 4, 10> cache(chrono::seconds(30));
+     *     queryEvent.setAnswerCache(cache);		// cache hits are answered by 'reportAndWaitForAnswer(...)' without touching the queue
+     *     cache.invalidateOn(updateEvent);		// updates of a record invalidate its cached version
+     *
+     * Entries are spread among 2^_Log2_Shards shards, each with its own mutex and 2^_Log2_EntriesPerShard entries, organized as
+     * 'nWays'-way sets: a parameter may only be stored in the set its hash points to, where the CLOCK algorithm elects which
+     * entry to evict -- so lookups, insertions and evictions are all bounded to 'nWays' entries.
+     * Each set counts its invalidations: an answer produced after a miss is only stored if no invalidation hit its set meanwhile,
+     * so a stale answer never overwrites a newer invalidation (see the 'Generation' overloads of 'lookup(...)' & 'store(...)').
+     *
+    */
+	template <typename _ArgumentType, typename _AnswerType, uint_fast8_t _Log2_Shards, uint_fast8_t _Log2_EntriesPerShard,
+	          typename _Hash = std::hash<_ArgumentType>, typename _KeyEqual = std::equal_to<_ArgumentType>>
+	class AnswerCache {
+
+	public:
+
+		constexpr static unsigned int nShards         = (unsigned int) 1 << (unsigned int) _Log2_Shards;
+		constexpr static unsigned int entriesPerShard = (unsigned int) 1 << (unsigned int) _Log2_EntriesPerShard;
+		constexpr static unsigned int nWays           = entriesPerShard < 8 ? entriesPerShard : 8;
+		constexpr static unsigned int setsPerShard    = entriesPerShard / nWays;
+
+		typedef unsigned long long Generation;	// the number of invalidations a set went through
+
+		struct Entry {
+			size_t             hash;
+			_ArgumentType      eventParameter;
+			_AnswerType        answer;
+			unsigned long long expirationNS;	// 0 if the entry never expires
+			bool               isUsed;
+			bool               isReferenced;	// CLOCK's "second chance" bit
+		};
+
+		struct alignas(64) Shard {
+			mutex              guard;
+			Entry              entries[entriesPerShard];
+			unsigned int       clockHands[setsPerShard];
+			Generation         generations[setsPerShard];
+			unsigned long long nHits;
+			unsigned long long nMisses;
+		};
+
+		Shard*             shards;
+		unsigned long long timeToLiveNS;	// 0: answers never expire
+		_Hash              hasher;
+		_KeyEqual          comparator;
+
+
+		/** 'timeToLive' of zero makes the answers valid until they are evicted or invalidated */
+		template <typename _Rep = long long, typename _Period = std::nano>
+		AnswerCache(chrono::duration<_Rep, _Period> timeToLive = chrono::nanoseconds(0))
+				: shards       (new Shard[nShards])
+				, timeToLiveNS (chrono::duration_cast<chrono::nanoseconds>(timeToLive).count()) {
+			for (unsigned int s=0; s<nShards; s++) {
+				for (Entry& entry : shards[s].entries) {
+					entry.isUsed       = false;
+					entry.isReferenced = false;
+				}
+				for (unsigned int& clockHand : shards[s].clockHands) {
+					clockHand = 0;
+				}
+				for (Generation& generation : shards[s].generations) {
+					generation = 0;
+				}
+				shards[s].nHits   = 0;
+				shards[s].nMisses = 0;
+			}
+		}
+
+		~AnswerCache() {
+			delete[] shards;
+		}
+
+		/** Copies the cached answer for 'eventParameter' into 'answer', returning true -- or returns false if it is not cached (or expired) */
+		bool lookup(const _ArgumentType& eventParameter, _AnswerType* answer) {
+			Generation generation;
+			return lookup(eventParameter, answer, generation);
+		}
+
+		/** Same as above, also telling the 'generation' of the set of 'eventParameter' -- to be given to 'store(...)' after a miss */
+		bool lookup(const _ArgumentType& eventParameter, _AnswerType* answer, Generation& generation) {
+			size_t hash  = hasher(eventParameter);
+			Shard& shard = getShard(hash);
+			scoped_lock<mutex> lock(shard.guard);
+			generation = shard.generations[getSet(hash)];
+			Entry* entry = find(shard, hash, eventParameter);
+			if (entry != nullptr) {
+				if ( (entry->expirationNS == 0) || (getMonotonicTimeNS() < entry->expirationNS) ) {
+					entry->isReferenced = true;
+					*answer = entry->answer;
+					shard.nHits++;
+					return true;
+				}
+				entry->isUsed = false;
+			}
+			shard.nMisses++;
+			return false;
+		}
+
+		/** Caches 'answer' for 'eventParameter', evicting the least recently used entry of its set if needed */
+		void store(const _ArgumentType& eventParameter, const _AnswerType& answer) {
+			size_t hash  = hasher(eventParameter);
+			Shard& shard = getShard(hash);
+			scoped_lock<mutex> lock(shard.guard);
+			unguardedStore(shard, hash, eventParameter, answer);
+		}
+
+		/** Same as above, unless the set of 'eventParameter' was invalidated since 'lookup(...)' told its 'generation' -- in which case
+		 *  'answer' may predate the invalidation and is not stored. Returns whether it was */
+		bool store(const _ArgumentType& eventParameter, const _AnswerType& answer, Generation generation) {
+			size_t hash  = hasher(eventParameter);
+			Shard& shard = getShard(hash);
+			scoped_lock<mutex> lock(shard.guard);
+			if (shard.generations[getSet(hash)] != generation) {
+				return false;
+			}
+			unguardedStore(shard, hash, eventParameter, answer);
+			return true;
+		}
+
+		/** Forgets the cached answer for 'eventParameter', if any -- also preventing answers produced before this call from being stored */
+		void invalidate(const _ArgumentType& eventParameter) {
+			size_t hash  = hasher(eventParameter);
+			Shard& shard = getShard(hash);
+			scoped_lock<mutex> lock(shard.guard);
+			shard.generations[getSet(hash)]++;
+			Entry* entry = find(shard, hash, eventParameter);
+			if (entry != nullptr) {
+				entry->isUsed = false;
+			}
+		}
+
+		void invalidateAll() {
+			for (unsigned int s=0; s<nShards; s++) {
+				scoped_lock<mutex> lock(shards[s].guard);
+				for (Entry& entry : shards[s].entries) {
+					entry.isUsed = false;
+				}
+				for (Generation& generation : shards[s].generations) {
+					generation++;
+				}
+			}
+		}
+
+		/** Have events reported on 'link' (whose parameter must be this cache's key) invalidate the cached answer for their parameters */
+		template <typename _QueueEventLink>
+		void invalidateOn(_QueueEventLink& link) {
+			link.addListener(_QueueEventLink::Listener::template fromMethod<&AnswerCache::invalidate>(this));
+		}
+
+		unsigned long long getNumberOfHits() {
+			unsigned long long nHits = 0;
+			for (unsigned int s=0; s<nShards; s++) {
+				scoped_lock<mutex> lock(shards[s].guard);
+				nHits += shards[s].nHits;
+			}
+			return nHits;
+		}
+
+		unsigned long long getNumberOfMisses() {
+			unsigned long long nMisses = 0;
+			for (unsigned int s=0; s<nShards; s++) {
+				scoped_lock<mutex> lock(shards[s].guard);
+				nMisses += shards[s].nMisses;
+			}
+			return nMisses;
+		}
+
+	private:
+
+		inline void unguardedStore(Shard& shard, size_t hash, const _ArgumentType& eventParameter, const _AnswerType& answer) {
+			Entry* entry = find(shard, hash, eventParameter);
+			if (entry == nullptr) {
+				entry = evict(shard, hash);
+				entry->hash           = hash;
+				entry->eventParameter = eventParameter;
+				entry->isUsed         = true;
+			}
+			entry->answer       = answer;
+			entry->expirationNS = timeToLiveNS == 0 ? 0 : getMonotonicTimeNS() + timeToLiveNS;
+			entry->isReferenced = false;
+		}
+
+		inline Shard& getShard(size_t hash) {
+			return shards[hash & (nShards-1)];
+		}
+
+		inline unsigned int getSet(size_t hash) {
+			return (hash >> _Log2_Shards) & (setsPerShard-1);
+		}
+
+		inline Entry* find(Shard& shard, size_t hash, const _ArgumentType& eventParameter) {
+			Entry* set = &shard.entries[getSet(hash) * nWays];
+			for (unsigned int way=0; way<nWays; way++) {
+				if ( set[way].isUsed && (set[way].hash == hash) && comparator(set[way].eventParameter, eventParameter) ) {
+					return &set[way];
+				}
+			}
+			return nullptr;
+		}
+
+		/** CLOCK: returns a free entry of the set -- or the first one, from the clock hand on, not referenced since it was last visited */
+		inline Entry* evict(Shard& shard, size_t hash) {
+			unsigned int  setIndex  = getSet(hash);
+			Entry*        set       = &shard.entries[setIndex * nWays];
+			unsigned int& clockHand = shard.clockHands[setIndex];
+			for (unsigned int way=0; way<nWays; way++) {
+				if (!set[way].isUsed) {
+					return &set[way];
+				}
+			}
+			while (set[clockHand].isReferenced) {
+				set[clockHand].isReferenced = false;
+				clockHand = (clockHand+1) % nWays;
+			}
+			Entry* victim = &set[clockHand];
+			clockHand = (clockHand+1) % nWays;
+			return victim;
+		}
+
+		static inline unsigned long long getMonotonicTimeNS() {
+			return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_ANSWERCACHE_H_ */
@@ -0,0 +1,155 @@
+#ifndef MUTUA_EVENTS_ANSWERGROUPS_H_
+#define MUTUA_EVENTS_ANSWERGROUPS_H_
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+
+namespace mutua::events {
+
+	/**
+     * AnswerGroups.h
+     * ==============
+     *
+     * Waiting for the answers of several answerfull events at once -- possibly from different 'QueueEventLink' types -- as in
+     * the README's "QUERY1 / QUERY2 / QUERY3" example:
+     *
+     *     waitForAllAnswers(q1Event.getAnswerHandle(q1EventId), q2Event.getAnswerHandle(q2EventId), q3Event.getAnswerHandle(q3EventId));
+     *
+     * Instead of sleeping & waking up once for each answer, the waiter sleeps on a single mutex, which is unlocked by the completion
+     * (see 'QueueEventLink::completeAnswerfullEvent(...)') that satisfies the group -- so the waiter wakes exactly once.
+     * Answers (or the exceptions that prevented them) are then taken, without blocking, with 'AnswerHandle::waitForAnswer()'.
+     * The given events must be distinct, must not have an 'AnswerHandler' and must not be awaited by anyone else.
+     *
+    */
+	class AnswerGroup {
+
+	public:
+
+		timed_mutex  waitGuard;					// locked while the group is not satisfied -- unlocked by the completion that satisfies it
+		atomic<int>  nCompletions;
+		atomic<int>  nFinishedCompletions;		// completions that will no longer touch this object
+		atomic<int>  firstCompletedIndex;
+		int          nHandles;
+		int          nCompletionsToSatisfy;
+
+		AnswerGroup(int nHandles, int nCompletionsToSatisfy)
+				: nCompletions          (0)
+				, nFinishedCompletions  (0)
+				, firstCompletedIndex   (-1)
+				, nHandles              (nHandles)
+				, nCompletionsToSatisfy (nCompletionsToSatisfy) {
+			waitGuard.lock();
+		}
+
+		/** The continuation set on each event -- also called directly for events already completed when attached */
+		void complete(int handleIndex) {
+			int noneCompleted = -1;
+			firstCompletedIndex.compare_exchange_strong(noneCompleted, handleIndex);
+			if (++nCompletions == nCompletionsToSatisfy) {
+				waitGuard.unlock();
+			}
+			nFinishedCompletions++;
+		}
+
+		template <typename _AnswerHandle>
+		static void checkAwaitable(const _AnswerHandle& handle) {
+			auto& event = handle.link->events[handle.eventId];
+			if (event.answerObjectReference == nullptr) {
+				handle.link->throwNotAnswerfullException();
+			}
+			if (event.hasAnswerHandler) {
+				THROW_EXCEPTION(runtime_error, "AnswerGroup: attempting to wait for an answer from an event of '" + handle.link->eventName + "', which has an 'AnswerHandler' -- it will be delivered to it.");
+			}
+			if (event.completionState == std::remove_pointer<decltype(handle.link)>::type::CONTINUATION_SET) {
+				THROW_EXCEPTION(runtime_error, "AnswerGroup: attempting to wait for an answer from an event of '" + handle.link->eventName + "', which is already being awaited.");
+			}
+		}
+
+		template <typename _AnswerHandle>
+		void attach(const _AnswerHandle& handle, int handleIndex) {
+			if (!handle.link->trySetContinuation(handle.link->events[handle.eventId], [this, handleIndex] { complete(handleIndex); })) {
+				// already completed
+				complete(handleIndex);
+			}
+		}
+
+		/** Takes our continuation out of the event, if it has not completed yet */
+		template <typename _AnswerHandle>
+		void detach(const _AnswerHandle& handle) {
+			typedef typename std::remove_pointer<decltype(handle.link)>::type _QueueEventLink;
+			auto&   event           = handle.link->events[handle.eventId];
+			uint8_t continuationSet = _QueueEventLink::CONTINUATION_SET;
+			if (event.completionState.compare_exchange_strong(continuationSet, _QueueEventLink::PENDING, memory_order_acq_rel)) {
+				// will never be completed on our behalf
+				nFinishedCompletions++;
+			}
+		}
+
+		/** Waits for the group to be satisfied (or for 'timeoutNS', if positive), then detaches from all events -- waiting for any
+		 *  completion running concurrently to finish, so this object may be safely destroyed. Returns whether the group got satisfied */
+		template <typename... _AnswerHandles>
+		bool wait(long long timeoutNS, const _AnswerHandles&... handles) {
+			(checkAwaitable(handles), ...);
+			int handleIndex = 0;
+			(attach(handles, handleIndex++), ...);
+			bool isSatisfied;
+			if (timeoutNS < 0) {
+				waitGuard.lock();
+				isSatisfied = true;
+			} else {
+				isSatisfied = waitGuard.try_lock_for(chrono::nanoseconds(timeoutNS));
+			}
+			if (isSatisfied) {
+				waitGuard.unlock();
+			}
+			(detach(handles), ...);
+			while (nFinishedCompletions < nHandles) {
+				this_thread::yield();
+			}
+			if (!isSatisfied && (nCompletions < nCompletionsToSatisfy)) {
+				// no completion unlocked it
+				waitGuard.unlock();
+			}
+			return nCompletions >= nCompletionsToSatisfy;
+		}
+	};
+
+	/** Blocks until all the given answerfull events ('QueueEventLink::AnswerHandle's) are answered -- waking up only once */
+	template <typename... _AnswerHandles>
+	void waitForAllAnswers(const _AnswerHandles&... handles) {
+		AnswerGroup group(sizeof...(handles), sizeof...(handles));
+		group.wait(-1, handles...);
+	}
+
+	/** Same as above, but giving up after 'timeout' -- returns false if not all answers got ready in time */
+	template <typename _Rep, typename _Period, typename... _AnswerHandles>
+	bool waitForAllAnswers(chrono::duration<_Rep, _Period> timeout, const _AnswerHandles&... handles) {
+		AnswerGroup group(sizeof...(handles), sizeof...(handles));
+		return group.wait(chrono::duration_cast<chrono::nanoseconds>(timeout).count(), handles...);
+	}
+
+	/** Blocks until any of the given answerfull events ('QueueEventLink::AnswerHandle's) is answered, returning its index on the argument list */
+	template <typename... _AnswerHandles>
+	int waitForAnyAnswer(const _AnswerHandles&... handles) {
+		AnswerGroup group(sizeof...(handles), 1);
+		group.wait(-1, handles...);
+		return group.firstCompletedIndex;
+	}
+
+	/** Same as above, but giving up after 'timeout' -- returning -1 if no answer got ready in time */
+	template <typename _Rep, typename _Period, typename... _AnswerHandles>
+	int waitForAnyAnswer(chrono::duration<_Rep, _Period> timeout, const _AnswerHandles&... handles) {
+		AnswerGroup group(sizeof...(handles), 1);
+		return group.wait(chrono::duration_cast<chrono::nanoseconds>(timeout).count(), handles...) ? (int)group.firstCompletedIndex : -1;
+	}
+
+}
+#endif /* MUTUA_EVENTS_ANSWERGROUPS_H_ */
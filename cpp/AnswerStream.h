@@ -0,0 +1,155 @@
+#ifndef MUTUA_EVENTS_ANSWERSTREAM_H_
+#define MUTUA_EVENTS_ANSWERSTREAM_H_
+
+#include <mutex>
+#include <exception>
+#include <utility>
+using namespace std;
+
+
+namespace mutua::events {
+
+	/**
+     * AnswerStream.h
+     * ==============
+     *
+     * A bounded, single producer / single consumer channel of answer chunks, to be used as the '_AnswerType' of a 'QueueEventLink'
+     * whose answers are large and produced in parts -- file reads, paginated database scans, ... Please note the roles here are the
+     * other way around: the event consumer 'push'es the chunks as they are ready and the event producer 'pop's them as they arrive,
+     * so the time to the first chunk does not depend on the time to produce the whole answer.
+     * See 'QueueEventLink::setStreamingConsumer(...)', which closes (or fails) the stream when the consumer returns (or throws).
+     *
+     * Blocking follows the same mutex handoff idea of 'QueueEventLink': 'emptyGuard' is locked while there is nothing to pop
+     * and 'fullGuard' is locked while there is no room to push.
+     *
+    */
+	template <typename _ChunkType, uint_fast8_t _Log2_Capacity>
+	class AnswerStream {
+
+	public:
+
+		typedef _ChunkType ChunkType;
+
+		constexpr static unsigned int capacity        = (unsigned int) 1 << (unsigned int) _Log2_Capacity;
+		constexpr static unsigned int capacityModulus = capacity-1;
+
+		_ChunkType    chunks[capacity];
+		unsigned int  head;				// next chunk to pop
+		unsigned int  tail;				// next chunk to push
+		unsigned int  length;
+		bool          isClosed;			// no more chunks will be pushed
+		bool          isAbandoned;		// no more chunks will be popped
+		exception_ptr exception;		// set if the stream was failed -- rethrown by 'pop(...)' after the already pushed chunks
+
+		mutex         guard;
+		mutex         emptyGuard;
+		mutex         fullGuard;
+
+
+		AnswerStream()
+				: head        (0)
+				, tail        (0)
+				, length      (0)
+				, isClosed    (false)
+				, isAbandoned (false)
+				, exception   (nullptr) {
+			// starts empty & locked for popping
+			emptyGuard.lock();
+		}
+
+		/** Consumer side: makes 'chunk' available to the producer, blocking if the stream is full.
+		 *  Returns false if the producer abandoned the stream -- so there is no point in producing any further chunks */
+		bool push(_ChunkType chunk) {
+
+		 FULL_STREAM_RETRY:
+
+			guard.lock();
+			if (isAbandoned) {
+				guard.unlock();
+				return false;
+			}
+			if (length == capacity) {
+				guard.unlock();
+				fullGuard.lock();	// 2nd lock. Wait here until 'pop(...)' makes room
+				fullGuard.unlock();
+				goto FULL_STREAM_RETRY;
+			}
+			chunks[tail] = std::move(chunk);
+			tail = (tail+1) & capacityModulus;
+			length++;
+			if (length == capacity) {
+				fullGuard.lock();	// 1st lock. Won't wait yet.
+			}
+			if (length == 1) {
+				emptyGuard.unlock();
+			}
+			guard.unlock();
+			return true;
+		}
+
+		/** Consumer side: no more chunks will be pushed */
+		void close() {
+			guard.lock();
+			if (!isClosed) {
+				isClosed = true;
+				if (length == 0) {
+					emptyGuard.unlock();	// 'pop(...)' won't touch it again
+				}
+			}
+			guard.unlock();
+		}
+
+		/** Consumer side: closes the stream, having 'pop(...)' rethrowing 'e' once the already pushed chunks are consumed */
+		void fail(exception_ptr e) {
+			guard.lock();
+			exception = e;
+			guard.unlock();
+			close();
+		}
+
+		/** Producer side: moves the next chunk into 'chunk', blocking until one is available. Returns false when the stream
+		 *  is closed and there are no more chunks -- or rethrows the exception the stream was failed with */
+		bool pop(_ChunkType& chunk) {
+
+		 EMPTY_STREAM_RETRY:
+
+			guard.lock();
+			if (length == 0) {
+				if (isClosed) {
+					guard.unlock();
+					if (exception != nullptr) {
+						std::rethrow_exception(exception);
+					}
+					return false;
+				}
+				guard.unlock();
+				emptyGuard.lock();	// 2nd lock. Wait here until 'push(...)' or 'close()' is called
+				emptyGuard.unlock();
+				goto EMPTY_STREAM_RETRY;
+			}
+			chunk = std::move(chunks[head]);
+			head = (head+1) & capacityModulus;
+			length--;
+			if (length == capacity-1) {
+				fullGuard.unlock();
+			}
+			if ( (length == 0) && (!isClosed) ) {
+				emptyGuard.lock();	// 1st lock. Won't wait yet.
+			}
+			guard.unlock();
+			return true;
+		}
+
+		/** Producer side: no more chunks will be popped -- a blocked or further 'push(...)' will return false */
+		void abandon() {
+			guard.lock();
+			isAbandoned = true;
+			if (length == capacity) {
+				fullGuard.unlock();		// 'push(...)' won't touch it again
+			}
+			guard.unlock();
+		}
+	};
+}
+
+#endif /* MUTUA_EVENTS_ANSWERSTREAM_H_ */
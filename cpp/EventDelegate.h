@@ -0,0 +1,202 @@
+#ifndef MUTUA_EVENTS_EVENTDELEGATE_H_
+#define MUTUA_EVENTS_EVENTDELEGATE_H_
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+using namespace std;
+
+
+namespace mutua::events {
+
+	template <typename _Signature, size_t _CaptureSize = 4*sizeof(void*)>
+	class EventDelegate;
+
+    /**
+     * EventDelegate.h
+     * ===============
+     *
+     * A callable reference used everywhere a consumer or listener is registered: a function pointer ('invoker') plus
+     * a small buffer, of '_CaptureSize' bytes, where the callee's context is stored -- an instance pointer, a member
+     * function pointer or a whole lambda with its captures. No heap allocation & no virtual dispatch are involved,
+     * as described on the "Impossibly Fast C++ Delegates" articles cited on the README.
+     *
+     * Accepted callees, from the fastest to the slowest:
+     *   - EventDelegate<void(const int&)>::fromMethod<&MyClass::myMethod>(&myInstance) -- the method is a template parameter,
+     *     so it is called directly (and may even be inlined) by the invoker;
+     *   - lambdas & functors: [&](const int& p) {...} -- the functor's body is also called directly by the invoker.
+     *     They must fit into '_CaptureSize' (this is checked at compile time);
+     *   - free functions: EventDelegate<void(const int&)>(myFunction) -- one additional indirect call;
+     *   - EventDelegate<void(const int&)>(&MyClass::myMethod, &myInstance) -- the method pointer is only known at
+     *     runtime, requiring one additional indirect call as well. This is what the legacy member-pointer registration
+     *     methods (like 'QueueEventLink::setAnswerlessConsumer(&MyClass::myMethod, {...})') use.
+     *
+    */
+	template <typename _Return, typename... _Args, size_t _CaptureSize>
+	class EventDelegate<_Return(_Args...), _CaptureSize> {
+
+	private:
+
+		typedef _Return (*Invoker) (void* storage, _Args... args);
+		typedef void    (*Manager) (void* destinationStorage, const void* sourceStorage);	// copies 'sourceStorage' into 'destinationStorage' or, if 'sourceStorage' is nullptr, destroys 'destinationStorage'
+
+		Invoker invoker;
+		Manager manager;	// nullptr for trivially copyable & destructible callees
+		alignas(alignof(std::max_align_t)) unsigned char storage[_CaptureSize];
+
+		// invokers
+		///////////
+
+		template <typename _Functor>
+		static _Return invokeFunctor(void* storage, _Args... args) {
+			return (*reinterpret_cast<_Functor*>(storage))(std::forward<_Args>(args)...);
+		}
+
+		static _Return invokeFunction(void* storage, _Args... args) {
+			return (*reinterpret_cast<_Return (**) (_Args...)>(storage))(std::forward<_Args>(args)...);
+		}
+
+		template <typename _Class>
+		struct RuntimeMethodAndInstance {
+			_Return (_Class::*method) (_Args...);
+			_Class*  instance;
+		};
+		template <typename _Class>
+		static _Return invokeRuntimeMethod(void* storage, _Args... args) {
+			RuntimeMethodAndInstance<_Class>& methodAndInstance = *reinterpret_cast<RuntimeMethodAndInstance<_Class>*>(storage);
+			return (methodAndInstance.instance->*methodAndInstance.method)(std::forward<_Args>(args)...);
+		}
+
+		template <auto _Method, typename _Class>
+		static _Return invokeMethod(void* storage, _Args... args) {
+			return ((*reinterpret_cast<_Class**>(storage))->*_Method)(std::forward<_Args>(args)...);
+		}
+
+		// managers
+		///////////
+
+		template <typename _Functor>
+		static void manageFunctor(void* destinationStorage, const void* sourceStorage) {
+			if (sourceStorage == nullptr) {
+				reinterpret_cast<_Functor*>(destinationStorage)->~_Functor();
+			} else {
+				new (destinationStorage) _Functor(*reinterpret_cast<const _Functor*>(sourceStorage));
+			}
+		}
+
+		template <typename _Callee>
+		void storeTrivially(const _Callee& callee, Invoker calleeInvoker) {
+			static_assert(sizeof(_Callee) <= _CaptureSize, "EventDelegate: callee doesn't fit into '_CaptureSize' bytes");
+			memcpy(storage, &callee, sizeof(_Callee));
+			invoker = calleeInvoker;
+		}
+
+		void copyFrom(const EventDelegate& other) {
+			invoker = other.invoker;
+			manager = other.manager;
+			if (manager == nullptr) {
+				memcpy(storage, other.storage, _CaptureSize);
+			} else {
+				memset(storage, 0, _CaptureSize);
+				manager(storage, other.storage);
+			}
+		}
+
+		void destroy() {
+			if (manager != nullptr) {
+				manager(storage, nullptr);
+				manager = nullptr;
+			}
+			invoker = nullptr;
+		}
+
+	public:
+
+		/** An empty delegate -- check with 'operator bool' before invoking */
+		EventDelegate()
+				: invoker (nullptr)
+				, manager (nullptr)
+				, storage {} {}
+
+		EventDelegate(nullptr_t)
+				: EventDelegate() {}
+
+		/** Delegates to a free function (or static method) */
+		EventDelegate(_Return (*function) (_Args...))
+				: EventDelegate() {
+			if (function != nullptr) {
+				storeTrivially(function, &invokeFunction);
+			}
+		}
+
+		/** Delegates to a member function known only at runtime, to act on 'instance' */
+		template <typename _Class>
+		EventDelegate(_Return (_Class::*method) (_Args...), _Class* instance)
+				: EventDelegate() {
+			storeTrivially(RuntimeMethodAndInstance<_Class>{method, instance}, &invokeRuntimeMethod<_Class>);
+		}
+
+		/** Delegates to a lambda or functor, which is copied into this delegate */
+		template <typename _Functor, typename _DecayedFunctor = typename std::decay<_Functor>::type,
+		          typename = std::enable_if_t<!std::is_same<_DecayedFunctor, EventDelegate>::value &&
+		                                      !std::is_pointer<_DecayedFunctor>::value &&
+		                                      std::is_invocable_r<_Return, _DecayedFunctor&, _Args...>::value>>
+		EventDelegate(_Functor&& functor)
+				: EventDelegate() {
+			static_assert(sizeof(_DecayedFunctor)  <= _CaptureSize,                      "EventDelegate: functor / lambda captures don't fit into '_CaptureSize' bytes");
+			static_assert(alignof(_DecayedFunctor) <= alignof(std::max_align_t),         "EventDelegate: functor / lambda is over-aligned");
+			new (storage) _DecayedFunctor(std::forward<_Functor>(functor));
+			invoker = &invokeFunctor<_DecayedFunctor>;
+			if constexpr (!(std::is_trivially_copyable<_DecayedFunctor>::value && std::is_trivially_destructible<_DecayedFunctor>::value)) {
+				manager = &manageFunctor<_DecayedFunctor>;
+			}
+		}
+
+		/** Delegates to '_Method', known at compile time, to act on 'instance' -- the fastest of all delegates */
+		template <auto _Method, typename _Class>
+		static EventDelegate fromMethod(_Class* instance) {
+			EventDelegate delegate;
+			delegate.storeTrivially(instance, &invokeMethod<_Method, _Class>);
+			return delegate;
+		}
+
+		EventDelegate(const EventDelegate& other) {
+			copyFrom(other);
+		}
+
+		EventDelegate& operator= (const EventDelegate& other) {
+			if (this != &other) {
+				destroy();
+				copyFrom(other);
+			}
+			return *this;
+		}
+
+		~EventDelegate() {
+			destroy();
+		}
+
+		inline _Return operator() (_Args... args) const {
+			return invoker(const_cast<unsigned char*>(storage), std::forward<_Args>(args)...);
+		}
+
+		explicit inline operator bool() const {
+			return invoker != nullptr;
+		}
+
+		/** Two delegates are equal if they call the same code on the same context -- for functors with captures,
+		 *  this means they were copied from the same object (or from objects with the same bit representation) */
+		bool operator== (const EventDelegate& other) const {
+			return (invoker == other.invoker) && (memcmp(storage, other.storage, _CaptureSize) == 0);
+		}
+
+		bool operator!= (const EventDelegate& other) const {
+			return !(*this == other);
+		}
+
+	};
+
+}
+#endif /* MUTUA_EVENTS_EVENTDELEGATE_H_ */
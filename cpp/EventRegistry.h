@@ -0,0 +1,109 @@
+#ifndef MUTUA_EVENTS_EVENTREGISTRY_H_
+#define MUTUA_EVENTS_EVENTREGISTRY_H_
+
+#include <string>
+#include <array>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+using namespace std;
+
+
+namespace mutua::events {
+
+	/** Binds '_EventId' (a value of the application's events enumeration) to the type of the link carrying it -- see 'EventRegistry' */
+	template <auto _EventId, class _Link>
+	struct EventRegistration {
+		constexpr static auto eventId = _EventId;
+		typedef _Link LinkType;
+	};
+
+	/**
+     * EventRegistry.h
+     * ===============
+     *
+     * Owns the links of an application, indexed by its events enumeration -- whose values must be listed, in order, by '_Registrations':
+     *
+     *     enum class ServerEvents {StaticRequest, DynamicRequest, CacheMiss};
+     *     EventRegistry<ServerEvents,
+     *                   EventRegistration<ServerEvents::StaticRequest,  QueueEventLink<bool,   Request, 10, 8>>,
+     *                   EventRegistration<ServerEvents::DynamicRequest, QueueEventLink<string, Request, 10, 8>>,
+     *                   EventRegistration<ServerEvents::CacheMiss,      QueueEventLink<bool,   string,  10, 4>>>
+     *         serverEvents({"static requests", "dynamic requests", "cache misses"});
+     *
+     *     serverEvents.reportEvent<ServerEvents::CacheMiss>(URI);
+     *     serverEvents.forEachLink([](ServerEvents event, auto& link) { link.close(); });
+     *
+     * The links live in a tuple: 'link<E>()' & 'reportEvent<E>(...)' resolve, at compile time, to the concrete link & its concrete
+     * type -- with no lookups -- while 'forEachLink(...)' visits all of them (for starting dispatchers, shutting down, gathering metrics, ...).
+     *
+    */
+	template <typename _EventsEnum, class... _Registrations>
+	class EventRegistry {
+
+		static_assert(std::is_enum<_EventsEnum>::value, "EventRegistry: '_EventsEnum' must be an enumeration");
+
+		/** true if each registration's event id matches its position */
+		template <size_t... _Indexes>
+		constexpr static bool areRegistrationsInOrder(index_sequence<_Indexes...>) {
+			return ( ((size_t) _Registrations::eventId == _Indexes) && ... );
+		}
+		static_assert(areRegistrationsInOrder(index_sequence_for<_Registrations...>{}),
+		              "EventRegistry: '_Registrations' must list the '_EventsEnum' values in order, starting at 0");
+
+	public:
+
+		constexpr static size_t nEvents = sizeof...(_Registrations);
+
+		template <_EventsEnum _EventId>
+		using LinkType = typename tuple_element<(size_t) _EventId, tuple<typename _Registrations::LinkType...>>::type;
+
+	private:
+
+		tuple<typename _Registrations::LinkType...> links;
+
+
+		template <size_t... _Indexes>
+		EventRegistry(const array<string, nEvents>& eventNames, index_sequence<_Indexes...>)
+				: links (eventNames[_Indexes]...) {}
+
+	public:
+
+		/** Constructs each link with its name */
+		EventRegistry(const array<string, nEvents>& eventNames)
+				: EventRegistry(eventNames, index_sequence_for<_Registrations...>{}) {}
+
+		/** The link of '_EventId' -- with its concrete type */
+		template <_EventsEnum _EventId>
+		inline LinkType<_EventId>& link() {
+			return std::get<(size_t) _EventId>(links);
+		}
+
+		/** Reports an answerless '_EventId' event */
+		template <_EventsEnum _EventId, typename _ArgumentType>
+		inline int reportEvent(const _ArgumentType& eventParameter) {
+			LinkType<_EventId>& eventLink = link<_EventId>();
+			decltype(eventLink.events[0].eventParameter)* reservedParameterReference;
+			int eventId = eventLink.reserveEventForReporting(reservedParameterReference);
+			*reservedParameterReference = eventParameter;
+			eventLink.reportReservedEvent(eventId);
+			return eventId;
+		}
+
+		/** Calls 'visitor(_EventsEnum event, auto& link)' for all links, in the enumeration order */
+		template <typename _Visitor>
+		void forEachLink(_Visitor&& visitor) {
+			visitLinks(visitor, index_sequence_for<_Registrations...>{});
+		}
+
+	private:
+
+		template <typename _Visitor, size_t... _Indexes>
+		inline void visitLinks(_Visitor& visitor, index_sequence<_Indexes...>) {
+			( visitor((_EventsEnum) _Indexes, std::get<_Indexes>(links)), ... );
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_EVENTREGISTRY_H_ */
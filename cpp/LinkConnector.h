@@ -0,0 +1,171 @@
+#ifndef MUTUA_EVENTS_LINKCONNECTOR_H_
+#define MUTUA_EVENTS_LINKCONNECTOR_H_
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+#include "EventDelegate.h"
+#include "QueueEventLink.h"
+
+
+namespace mutua::events {
+
+	/**
+     * LinkConnector.h
+     * ===============
+     *
+     * Pipelines answerless events from an upstream 'QueueEventLink' into a downstream one -- playing the role of the upstream
+     * link's dispatcher (so upstream consumers & listeners are not called).
+     *
+     * A consumer of the upstream link reporting into the downstream one would block inside the downstream 'reserveEventForReporting(...)'
+     * when it is full -- holding an upstream event and its dispatcher thread. Here, instead, once an upstream event is available, a
+     * downstream slot is reserved -- the credit -- before the event is dequeued: while the downstream link is full, upstream events simply
+     * stay queued (eventually holding the upstream producers back), so the backpressure flows to the source. No credit is held while the
+     * upstream link is idle -- a reserved slot would hold back every downstream event reserved after it. Credits left unused (when another
+     * thread dequeued the event first) are given back with 'discardReservedEvent(...)'.
+     *
+     * Events the downstream admission control rejects (see 'AdmissionPolicy::REJECT') are dropped and counted on 'nRejectedEvents'.
+     *
+     * When both links have the same '_ArgumentType', payloads are handed over with 'std::swap' -- no copies are made and the upstream
+     * slot gets back the downstream slot's previous payload, so any buffers it owns get recycled. Otherwise, a 'Transformer' must
+     * fill the downstream event from the upstream one.
+     *
+    */
+	template <class _UpstreamLink, class _DownstreamLink>
+	struct LinkConnector {
+
+		// types from the links:
+		typedef decltype(_UpstreamLink::QueueElement::eventParameter)   _UpstreamArgumentType;
+		typedef decltype(_DownstreamLink::QueueElement::eventParameter) _DownstreamArgumentType;
+		typedef EventDelegate<void (_UpstreamArgumentType&, _DownstreamArgumentType&)> Transformer;
+
+		_UpstreamLink&             upstream;
+		_DownstreamLink&           downstream;
+		Transformer                transformer;
+		unsigned int               nThreads;
+		thread*                    threads;
+		atomic<unsigned long long> nForwardedEvents;
+		atomic<unsigned long long> nRejectedEvents;		// upstream events dropped for being rejected by the downstream link
+
+
+		LinkConnector(_UpstreamLink& upstream, _DownstreamLink& downstream, unsigned int nThreads = 1, const Transformer& transformer = nullptr)
+				: upstream         (upstream)
+				, downstream       (downstream)
+				, transformer      (transformer)
+				, nThreads         (nThreads)
+				, nForwardedEvents (0)
+				, nRejectedEvents  (0) {
+			if constexpr (!std::is_same<_UpstreamArgumentType, _DownstreamArgumentType>::value) {
+				if (!transformer) {
+					THROW_EXCEPTION(invalid_argument, "LinkConnector: a 'Transformer' is needed for connecting '"+upstream.eventName+"' to '"+downstream.eventName+"', since their event parameter types differ");
+				}
+			}
+			threads = new thread[nThreads];
+			for (unsigned int i=0; i<nThreads; i++) {
+				threads[i] = thread(&LinkConnector::forwardingLoop, this);
+			}
+		}
+
+		~LinkConnector() {
+			join();
+			delete[] threads;
+		}
+
+		/** Waits for the forwarding threads to end -- which happens when the upstream link gets closed and drained (or when the
+		 *  downstream link gets closed). Returns the number of forwarded events */
+		unsigned long long join() {
+			for (unsigned int i=0; i<nThreads; i++) {
+				if (threads[i].joinable()) {
+					threads[i].join();
+				}
+			}
+			return nForwardedEvents;
+		}
+
+		void forwardingLoop() {
+			typename _UpstreamLink::QueueElement* upstreamEvent;
+			_DownstreamArgumentType*              downstreamParameter;
+			bool                                  isDownstreamClosed = false;
+			while (upstream.waitForDequeueableEvent()) {
+				// the credit: a reserved downstream slot
+				bool isRejected        = false;
+				int  downstreamEventId = reserveDownstreamEvent(downstreamParameter, isRejected, isDownstreamClosed);
+				if (isDownstreamClosed) {
+					return;
+				}
+				int upstreamEventId = upstream.tryReserveEventForDispatching(upstreamEvent);
+				if (upstreamEventId == -1) {
+					// another thread dequeued the event first
+					if (downstreamEventId != -1) {
+						downstream.discardReservedEvent(downstreamEventId);
+					}
+					continue;
+				}
+				upstream.dispatchDequeuedEvent(*upstreamEvent, [&](typename _UpstreamLink::QueueElement& event) {
+					if (isRejected) {
+						// the credit for this event was rejected: drop it
+						isRejected = false;
+						return;
+					}
+					if (downstreamEventId == -1) {
+						// the lane holder forwarding a deferred event, which came without a credit -- its dequeuer gave it back
+						downstreamEventId = reserveDownstreamEvent(downstreamParameter, isRejected, isDownstreamClosed);
+						if (downstreamEventId == -1) {
+							isRejected = false;
+							return;
+						}
+					}
+					if constexpr (std::is_same<_UpstreamArgumentType, _DownstreamArgumentType>::value) {
+						if (!transformer) {
+							std::swap(event.eventParameter, *downstreamParameter);
+						} else {
+							transformer(event.eventParameter, *downstreamParameter);
+						}
+					} else {
+						transformer(event.eventParameter, *downstreamParameter);
+					}
+					downstream.reportReservedEvent(downstreamEventId);
+					downstreamEventId = -1;
+					nForwardedEvents.fetch_add(1, memory_order_relaxed);
+				});
+				if (downstreamEventId != -1) {
+					// unused: the event was cancelled, expired or deferred to its lane
+					downstream.discardReservedEvent(downstreamEventId);
+				}
+				upstream.releaseEvent(upstreamEventId);
+				if (isDownstreamClosed) {
+					return;
+				}
+			}
+		}
+
+		/** Returns the reserved downstream 'eventId' -- or -1, setting 'isRejected' (the event must be dropped) or 'isDownstreamClosed' */
+		int reserveDownstreamEvent(_DownstreamArgumentType*& downstreamParameter, bool& isRejected, bool& isDownstreamClosed) {
+			try {
+				return downstream.reserveEventForReporting(downstreamParameter);
+			} catch (const EventRejected&) {
+				nRejectedEvents.fetch_add(1, memory_order_relaxed);
+				isRejected = true;
+				return -1;
+			} catch (...) {
+				scoped_lock<mutex> lock(downstream.queueGuard);
+				if (!downstream.isClosed) {
+					throw;
+				}
+				isDownstreamClosed = true;
+				return -1;
+			}
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_LINKCONNECTOR_H_ */
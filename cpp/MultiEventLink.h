@@ -0,0 +1,238 @@
+#ifndef MUTUA_EVENTS_MULTIEVENTLINK_H_
+#define MUTUA_EVENTS_MULTIEVENTLINK_H_
+
+#include <string>
+#include <tuple>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+using namespace std;
+
+#include "EventDelegate.h"
+#include "QueueEventLink.h"
+
+
+namespace mutua::events {
+
+	/** The index of '_Type' on '_Types' -- compile time error if it is not there */
+	template <typename _Type, typename... _Types>
+	struct EventTypeIndex;
+	template <typename _Type, typename... _Types>
+	struct EventTypeIndex<_Type, _Type, _Types...> {
+		constexpr static uint8_t value = 0;
+	};
+	template <typename _Type, typename _OtherType, typename... _Types>
+	struct EventTypeIndex<_Type, _OtherType, _Types...> {
+		constexpr static uint8_t value = 1 + EventTypeIndex<_Type, _Types...>::value;
+	};
+
+	/**
+	 * The parameter of 'MultiEventLink' slots: one of '_EventTypes', in place, plus its tag -- as large as the largest of them.
+	 * Type dependent operations (copying, destroying, dispatching) are resolved through static tables indexed by the tag.
+	 */
+	template <typename... _EventTypes>
+	struct TaggedEvent {
+
+		static_assert(sizeof...(_EventTypes) > 0 && sizeof...(_EventTypes) < 255, "TaggedEvent: from 1 to 254 event types are supported");
+
+		constexpr static uint8_t nEventTypes = sizeof...(_EventTypes);
+		constexpr static uint8_t noEvent     = nEventTypes;		// tag of the default constructed instances
+		constexpr static size_t  slotSize    = std::max({sizeof(_EventTypes)...});
+
+		template <typename _EventType>
+		constexpr static uint8_t tagOf = EventTypeIndex<_EventType, _EventTypes...>::value;
+
+		alignas(_EventTypes...) unsigned char storage[slotSize];
+		uint8_t tag;
+
+
+		TaggedEvent()
+				: tag(noEvent) {}
+
+		TaggedEvent(const TaggedEvent& other)
+				: tag(noEvent) {
+			*this = other;
+		}
+
+		TaggedEvent(TaggedEvent&& other)
+				: tag(noEvent) {
+			*this = std::move(other);
+		}
+
+		~TaggedEvent() {
+			reset();
+		}
+
+		TaggedEvent& operator= (const TaggedEvent& other) {
+			if (this != &other) {
+				reset();
+				if (other.tag != noEvent) {
+					copiers[other.tag](storage, other.storage);
+					tag = other.tag;
+				}
+			}
+			return *this;
+		}
+
+		TaggedEvent& operator= (TaggedEvent&& other) {
+			if (this != &other) {
+				reset();
+				if (other.tag != noEvent) {
+					movers[other.tag](storage, other.storage);
+					tag = other.tag;
+				}
+			}
+			return *this;
+		}
+
+		/** Constructs a '_EventType' in place, from 'args' -- destroying the previous event, if any */
+		template <typename _EventType, typename... _Args>
+		_EventType& emplace(_Args&&... args) {
+			reset();
+			_EventType* event = new (storage) _EventType(std::forward<_Args>(args)...);
+			tag = tagOf<_EventType>;
+			return *event;
+		}
+
+		template <typename _EventType>
+		bool holds() const {
+			return tag == tagOf<_EventType>;
+		}
+
+		/** Unchecked -- see 'holds()' */
+		template <typename _EventType>
+		const _EventType& get() const {
+			return *std::launder(reinterpret_cast<const _EventType*>(storage));
+		}
+
+		template <typename _EventType>
+		_EventType& get() {
+			return *std::launder(reinterpret_cast<_EventType*>(storage));
+		}
+
+		void reset() {
+			if (tag != noEvent) {
+				destructors[tag](storage);
+				tag = noEvent;
+			}
+		}
+
+		/** For 'QueueEventDispatcher' debug messages */
+		static string toString(const TaggedEvent& event) {
+			return event.tag == noEvent ? "<no event>"s : "<event type #"+to_string(event.tag)+">";
+		}
+
+	private:
+
+		template <typename _EventType>
+		static void destroy(void* storage) {
+			reinterpret_cast<_EventType*>(storage)->~_EventType();
+		}
+		template <typename _EventType>
+		static void copy(void* storage, const void* otherStorage) {
+			new (storage) _EventType(*reinterpret_cast<const _EventType*>(otherStorage));
+		}
+		template <typename _EventType>
+		static void move(void* storage, void* otherStorage) {
+			new (storage) _EventType(std::move(*reinterpret_cast<_EventType*>(otherStorage)));
+		}
+
+		constexpr static void (*destructors[]) (void*)              = {&destroy<_EventTypes>...};
+		constexpr static void (*copiers[])     (void*, const void*) = {&copy<_EventTypes>...};
+		constexpr static void (*movers[])      (void*, void*)       = {&move<_EventTypes>...};
+
+	};
+
+    /**
+     * MultiEventLink.h
+     * ================
+     *
+     * A 'QueueEventLink' carrying several related (answerless) event types -- as the README's 'SERVER_REQUEST_EVENTS' spike groups
+     * 'requestStaticContent' & 'requestDynamicContent' -- on a single ring, served by a single 'QueueEventDispatcher':
+     *
+     *     MultiEventLink<10, 8, RequestStaticContent, RequestDynamicContent> serverRequests("server requests");
+     *     serverRequests.setEventConsumer<RequestStaticContent>(&serveStaticContent);
+     *     serverRequests.setEventConsumer<RequestDynamicContent>(&serveDynamicContent);
+     *     QueueEventDispatcher serverDispatcher(serverRequests, ...);
+     *     serverRequests.reportEvent<RequestStaticContent>(socket, URI, true);
+     *
+     * Slots hold a 'TaggedEvent', sized for the largest event type, where events are constructed in place. The dispatcher calls a
+     * single answerless consumer which jumps, through a table built at compile time & indexed by the event tag, straight to the
+     * consumer of its type -- no 'std::visit' nor chains of type tests. Listeners receive the 'TaggedEvent' itself.
+     *
+    */
+	template <int _NListeners, uint_fast8_t _Log2_QueueSlots, typename... _EventTypes>
+	class MultiEventLink: public QueueEventLink<bool, TaggedEvent<_EventTypes...>, _NListeners, _Log2_QueueSlots> {
+
+	public:
+
+		typedef QueueEventLink<bool, TaggedEvent<_EventTypes...>, _NListeners, _Log2_QueueSlots> BaseLink;
+		typedef TaggedEvent<_EventTypes...>                                                      Event;
+
+		template <typename _EventType>
+		using EventConsumer = EventDelegate<void (const _EventType&)>;
+
+	private:
+
+		tuple<EventConsumer<_EventTypes>...> eventConsumers;
+		unsigned int                         nConsumerInstances;
+
+
+	public:
+
+		/** 'nConsumerInstances' must match the number of threads of the 'QueueEventDispatcher' -- the same event consumers are shared by
+		 *  all of them, so they must be thread safe if there are more than one */
+		MultiEventLink(string eventName, unsigned int nConsumerInstances = 1)
+				: BaseLink           (eventName)
+				, nConsumerInstances (nConsumerInstances) {}
+
+		/** Sets the consumer of '_EventType' events -- those with no consumer are dropped. To be called before the dispatcher is created */
+		template <typename _EventType>
+		void setEventConsumer(const EventConsumer<_EventType>& consumer) {
+			std::get<Event::template tagOf<_EventType>>(eventConsumers) = consumer;
+			BaseLink::setAnswerlessConsumer(vector<typename BaseLink::AnswerlessConsumer>(nConsumerInstances,
+			                                BaseLink::AnswerlessConsumer::template fromMethod<&MultiEventLink::dispatchEvent>(this)));
+		}
+
+		/** Reports a '_EventType' event, constructing it in place, from 'args'. Blocks if the link is full.
+		 *  Exceptions thrown by the '_EventType' constructor are rethrown, after giving the reserved slot back */
+		template <typename _EventType, typename... _Args>
+		int reportEvent(_Args&&... args) {
+			Event* reservedEvent;
+			int eventId = BaseLink::reserveEventForReporting(reservedEvent);
+			try {
+				reservedEvent->template emplace<_EventType>(std::forward<_Args>(args)...);
+			} catch (...) {
+				BaseLink::discardReservedEvent(eventId);
+				throw;
+			}
+			BaseLink::reportReservedEvent(eventId);
+			return eventId;
+		}
+
+	private:
+
+		template <typename _EventType>
+		static void consumeEvent(MultiEventLink& link, const Event& event) {
+			const EventConsumer<_EventType>& consumer = std::get<Event::template tagOf<_EventType>>(link.eventConsumers);
+			if (consumer) {
+				consumer(event.template get<_EventType>());
+			}
+		}
+
+		constexpr static void (*dispatchTable[]) (MultiEventLink&, const Event&) = {&consumeEvent<_EventTypes>...};
+
+		/** The answerless consumer given to the base link -- slots reported without an event (through the base link methods) are dropped */
+		void dispatchEvent(const Event& event) {
+			if (event.tag == Event::noEvent) {
+				return;
+			}
+			dispatchTable[event.tag](*this, event);
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_MULTIEVENTLINK_H_ */
@@ -0,0 +1,158 @@
+#ifndef MUTUA_EVENTS_MULTICASTDISPATCHER_H_
+#define MUTUA_EVENTS_MULTICASTDISPATCHER_H_
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+#include "EventDelegate.h"
+#include "QueueEventLink.h"
+
+
+namespace mutua::events {
+
+	/**
+     * MulticastDispatcher.h
+     * =====================
+     *
+     * Disruptor-like fan out: a group of listeners that follows the events reported on a 'QueueEventLink' with its own thread &
+     * cursor, at its own pace -- independently of the link's 'QueueEventDispatcher' (which still runs the consumers and the
+     * ordinary listeners) and of any other 'MulticastDispatcher'. Events are read straight from the link's slots, which are only
+     * reclaimed after the slowest cursor passed them -- so observers (logging, metrics, DDoS detection, ...) need neither copies
+     * of the events nor extra links, at the expense of holding the producers back if they don't keep up.
+     *
+     * Multi stage pipelines (decode -> enrich -> persist) may also share a single ring: a "stage" is a 'MulticastDispatcher' whose
+     * processors get the event parameter for writing and which depends on other stages -- it only reaches sequence 's' after all
+     * of its dependencies passed it, so it may read their results straight from the slot. As the ordinary listeners and consumers
+     * of the link don't wait on these barriers, they should not read the fields the stages write -- typically, the link is given a
+     * consumer-less 'QueueEventDispatcher' and the last stage does the consumer's job.
+     *
+     * Must be created while the link has no events in flight and stopped after the link's dispatcher -- see 'join()'.
+     *
+    */
+	template <class _QueueEventLink>
+	struct MulticastDispatcher {
+
+		// types from _QueueEventLink:
+		typedef decltype(_QueueEventLink::QueueElement::eventParameter) _ArgumentType;
+		typedef typename _QueueEventLink::Listener                      Listener;
+		typedef EventDelegate<void (_ArgumentType&)>                    StageProcessor;	// may write results into the event parameter
+
+		_QueueEventLink&             el;
+		vector<Listener>             listeners;
+		vector<StageProcessor>       processors;
+		vector<MulticastDispatcher*> dependencies;	// stages that must have passed a sequence before this one reaches it
+		atomic<unsigned long long>   cursor;		// sequence of the next event to be notified
+		thread                       cursorThread;
+
+
+		/** A listener group */
+		MulticastDispatcher(_QueueEventLink& el, vector<Listener> listeners)
+				: el        (el)
+				, listeners (listeners)
+				, cursor    (el.addMulticastCursor()) {
+			cursorThread = thread(&MulticastDispatcher::multicastLoop, this);
+		}
+
+		/** A pipeline stage, running after its 'dependencies' -- which must be created before it and joined after it */
+		MulticastDispatcher(_QueueEventLink& el, vector<MulticastDispatcher*> dependencies, vector<StageProcessor> processors)
+				: el           (el)
+				, processors   (processors)
+				, dependencies (dependencies)
+				, cursor       (el.addMulticastCursor()) {
+			cursorThread = thread(&MulticastDispatcher::multicastLoop, this);
+		}
+
+		~MulticastDispatcher() {
+			join();
+		}
+
+		/** Waits for all published events to be notified -- which only finishes after the link got closed. So, to be called after
+		 *  'QueueEventDispatcher::stopWhenEmpty()' or 'stopASAP()'. Returns the number of notified events */
+		unsigned long long join() {
+			if (cursorThread.joinable()) {
+				cursorThread.join();
+				el.removeMulticastCursor();
+			}
+			return cursor;
+		}
+
+		void multicastLoop() {
+			unsigned long long sequence = cursor.load(memory_order_relaxed);
+			while (true) {
+				unsigned long long publishedSequence = el.publishedSequence.load(memory_order_acquire);
+				if ((publishedSequence & ~_QueueEventLink::closedSequenceBit) == sequence) {
+					if (publishedSequence & _QueueEventLink::closedSequenceBit) {
+						// closed & caught up
+						return;
+					}
+					el.publishedSequence.wait(publishedSequence, memory_order_acquire);
+					continue;
+				}
+				if (!passBarrier(sequence)) {
+					continue;
+				}
+				int eventId = sequence & _QueueEventLink::queueSlotsModulus;
+				if (_QueueEventLink::isCancelledEvent(el.events[eventId])) {
+					// cancelled before being dispatched -- or a slot given back with 'discardReservedEvent(...)', holding no event
+				} else if (processors.size() > 0) {
+					process(el.events[eventId].eventParameter);
+				} else {
+					notifyListeners(el.events[eventId].eventParameter);
+				}
+				el.releaseEvent(eventId);
+				sequence++;
+				cursor.store(sequence, memory_order_release);
+				cursor.notify_all();
+			}
+		}
+
+		/** Returns true if all dependencies passed 'sequence' -- otherwise waits for the first one that didn't to move & returns false */
+		inline bool passBarrier(unsigned long long sequence) {
+			for (MulticastDispatcher* dependency : dependencies) {
+				unsigned long long dependencyCursor = dependency->cursor.load(memory_order_acquire);
+				if (dependencyCursor == sequence) {
+					dependency->cursor.wait(dependencyCursor, memory_order_acquire);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		inline void process(_ArgumentType& eventParameter) {
+			for (unsigned int i=0; i<processors.size(); i++) try {
+				processors[i](eventParameter);
+			} catch (const exception& e) {
+				DUMP_EXCEPTION(runtime_error("Exception in stage processor: "s + e.what()),
+				               "MulticastDispatcher for event '"+el.eventName+"': exception in stage processor #"+to_string(i)+".\n" +
+				               "Caused by: "+e.what());
+			} catch (...) {
+				DUMP_EXCEPTION(runtime_error("Unknown Exception in stage processor"),
+				               "MulticastDispatcher for event '"+el.eventName+"': exception in stage processor #"+to_string(i)+".\n" +
+				               "Caused by: <<unknown cause>>");
+			}
+		}
+
+		inline void notifyListeners(const _ArgumentType& eventParameter) {
+			for (unsigned int i=0; i<listeners.size(); i++) try {
+				listeners[i](eventParameter);
+			} catch (const exception& e) {
+				DUMP_EXCEPTION(runtime_error("Exception in multicast listener: "s + e.what()),
+				               "MulticastDispatcher for event '"+el.eventName+"': exception in multicast listener #"+to_string(i)+".\n" +
+				               "Caused by: "+e.what());
+			} catch (...) {
+				DUMP_EXCEPTION(runtime_error("Unknown Exception in multicast listener"),
+				               "MulticastDispatcher for event '"+el.eventName+"': exception in multicast listener #"+to_string(i)+".\n" +
+				               "Caused by: <<unknown cause>>");
+			}
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_MULTICASTDISPATCHER_H_ */
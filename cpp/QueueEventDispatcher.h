@@ -4,9 +4,12 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <pthread.h>
 #include <type_traits>
 #include <stdexcept>
+#include <vector>
 using namespace std;
 
 #include <BetterExceptions.h>
@@ -33,13 +36,42 @@ namespace mutua::events {
 		typedef std::remove_pointer<_AnswerTypePointer>                         _AnswerType;
 		typedef decltype(_QueueEventLink::QueueElement::eventParameter)         _ArgumentType;
 
-		bool             isActive;
+		atomic<bool>     isActive;
 		_QueueEventLink& el;
-		int              nThreads;
-		thread*          threads;
+		int              nThreads;				// dispatcher threads -- not counting the debug tracker thread
+		bool             debug;
+		thread*          threads;				// 'nThreads' dispatcher threads + the debug tracker thread, if 'debug' is set
+		bool             areThreadsJoined;
+		unsigned int     nLeftoverEvents;		// filled in when the threads are joined -- see 'joinThreads()'
+		timed_mutex      debugTrackerGuard;		// locked while active -- allows the debug tracker to sleep without delaying the shutdown
+
+		// autoscaling -- 'nThreads' dispatcher threads are created, but only the first 'nActiveThreads' of them dispatch events: the others are parked
+		/** Per thread figures, sampled by the autoscaler -- each one on its own cache line, so dispatcher threads don't disturb one another */
+		struct alignas(64) ThreadStatistics {
+			atomic<unsigned long long> dispatchingNS;			// accumulated wall time spent on consumers & listeners
+			atomic<unsigned long long> dispatchingSinceNS;		// when the event currently being dispatched was dequeued -- 0 if waiting for events
+		};
+		static constexpr chrono::milliseconds autoscalingInterval   = chrono::milliseconds(10);
+		static constexpr unsigned int         idleSamplesToPark     = 3;		// consecutive underused samples before a thread gets parked
+		int                minThreads;
+		bool               isAutoscaling;			// true if 'minThreads' < 'nThreads'
+		atomic<int>        nActiveThreads;
+		mutex*             parkingGuards;			// one per dispatcher thread: held by the autoscaler while the thread is parked
+		ThreadStatistics*  threadsStatistics;
+		thread             autoscalerThread;
+		timed_mutex        autoscalerGuard;			// locked while autoscaling -- same purpose as 'debugTrackerGuard'
+
+		// dispatching policies, as given to the constructor -- for the inline-when-idle hybrid execution
+		bool               notifyEvents;
+		bool               consumeAnswerlessEvents;
+		bool               consumeAnswerfullEvents;
+		bool               isInlineWhenIdle;		// if set, dispatcher threads hold the link's consumer instance guard while dispatching
 
 		string (*eventParameterToStringSerializer) (const _ArgumentType&);
 
+		static constexpr unsigned int       returningEventsBatchSize   = 16;		// see 'dispatchReturningEventsLoop(...)'
+		static constexpr unsigned long long returningAnswersMaxDelayNS = 50'000;	// idem
+
 		/** Instantiate a QueueEventDispatcher with the given  */
 		QueueEventDispatcher(_QueueEventLink& el,
 		                     int              nThreads,
@@ -49,57 +81,121 @@ namespace mutua::events {
 							 bool             consumeAnswerlessEvents,
 							 bool             consumeAnswerfullEvents,
 							 bool             debug)
-				: isActive(true)
-				, el(el)
-				, nThreads(nThreads+(debug ? 1 : 0)) {
+				: QueueEventDispatcher(el, nThreads, nThreads, threadsPriority, zeroCopy, notifyEvents, consumeAnswerlessEvents, consumeAnswerfullEvents, debug) {}
+
+		/** Instantiate an autoscaling QueueEventDispatcher, which keeps between 'minThreads' and 'maxThreads' threads dispatching events,
+		 *  in the search for the optimal number of concurrent consumer executions discussed on the README. Every 'autoscalingInterval',
+		 *  the queue length and the active threads' dispatching (busy) time, waiting (idle) time & CPU time are sampled:
+		 *    - a thread is added if events are waiting on the queue while the active threads are saturated -- provided there are spare
+		 *      CPU cores or the consumers spend a good share of their time blocked (off-CPU, on I/O or locks, for instance);
+		 *    - a thread is parked if the queue is empty while the active threads spend most of their time waiting for events.
+		 *  Parked threads sleep on a mutex, costing nothing while parked. 'getNumberOfActiveThreads()' tells the current 'n'.
+		 *  The consumer pool given to the link must have at least 'maxThreads' instances. */
+		QueueEventDispatcher(_QueueEventLink& el,
+		                     int              minThreads,
+		                     int              maxThreads,
+		                     int              threadsPriority,
+							 bool             zeroCopy,
+							 bool             notifyEvents,
+							 bool             consumeAnswerlessEvents,
+							 bool             consumeAnswerfullEvents,
+							 bool             debug)
+				: isActive          (true)
+				, el                (el)
+				, nThreads          (maxThreads)
+				, debug             (debug)
+				, areThreadsJoined  (false)
+				, nLeftoverEvents   (0)
+				, minThreads        (minThreads)
+				, isAutoscaling     (minThreads < maxThreads)
+				, nActiveThreads    (minThreads)
+				, parkingGuards     (nullptr)
+				, threadsStatistics (nullptr)
+				, notifyEvents            (notifyEvents)
+				, consumeAnswerlessEvents (consumeAnswerlessEvents)
+				, consumeAnswerfullEvents (consumeAnswerfullEvents)
+				, isInlineWhenIdle        (false) {
 
 			// checks
 			if (threadsPriority != 0) {
                 THROW_EXCEPTION(invalid_argument, "QueueEventDispatcher: Attempting to create a dispatcher for event '"+el.eventName+"' with custom " +
                                                   "'threadsPriority', and this is not implemented yet -- it must be zero in the meantime.");
 			}
-			if ( consumeAnswerlessEvents && (el.answerlessConsumerProcedureReference == nullptr) ) {
+			if ( (consumeAnswerlessEvents && (el.nAnswerlessConsumers == 0)) || (consumeAnswerfullEvents && (el.nAnswerfullConsumers == 0)) ) {
 				THROW_EXCEPTION(runtime_error, "QueueEventDispatcher: Attempting instantiate 'QueueEventDispatcher' before a consumer was set in QueueEventLink. This limitation might be improved in the future.");
 			}
-			if ( consumeAnswerlessEvents && (nThreads > el.nAnswerlessConsumerThese) ) {
+			if ( (minThreads < 1) || (minThreads > maxThreads) ) {
+                THROW_EXCEPTION(invalid_argument, "QueueEventDispatcher: Attempting to create a dispatcher for event '"+el.eventName+"' with invalid autoscaling bounds: " +
+                                                  "'minThreads' is "+to_string(minThreads)+" and 'maxThreads' is "+to_string(maxThreads)+" -- 1 <= minThreads <= maxThreads must hold.");
+			}
+			if ( consumeAnswerlessEvents && ((unsigned int) nThreads > el.nAnswerlessConsumers) ) {
 				THROW_EXCEPTION(runtime_error, "QueueEventDispatcher: Attempting to create a dispatcher for event '"+el.eventName+"' with "+to_string(nThreads)+" threads, " +
-                                               "but the given QueueEventLink is set to have only "+to_string(el.nAnswerlessConsumerThese)+" consumer objects on the instance pool " +
+                                               "but the given QueueEventLink is set to have only "+to_string(el.nAnswerlessConsumers)+" consumer objects on the instance pool " +
                                                "and this combination is not optimal. Please, arrange that -- most probably by increasing the array of objects given to 'setAnswerlessConsumer(...)'.\n" +
 											   "note: by now you must only instantiate a 'QueueEventDispatcher' after you have set the QueueEventLink consumer. This limitation might be improved in the future.");
 			}
-			if ( consumeAnswerfullEvents && (nThreads > el.nAnswerfullConsumerThese) ) {
+			if ( consumeAnswerfullEvents && ((unsigned int) nThreads > el.nAnswerfullConsumers) ) {
 				THROW_EXCEPTION(runtime_error, "QueueEventDispatcher: Attempting to create a dispatcher for event '"+el.eventName+"' with "+to_string(nThreads)+" threads, " +
-                                               "but the given QueueEventLink is set to have only "+to_string(el.nAnswerfullConsumerThese)+" consumer objects on the instance pool " +
+                                               "but the given QueueEventLink is set to have only "+to_string(el.nAnswerfullConsumers)+" consumer objects on the instance pool " +
                                                "and this combination is not optimal. Please, arrange that -- most probably by increasing the array of objects given to 'setAnswerfullConsumer(...)'.\n" +
 											   "note: by now you must only instantiate a 'QueueEventDispatcher' after you have set the QueueEventLink consumer. This limitation might be improved in the future.");
 			}
 
+			if (isAutoscaling) {
+				parkingGuards     = new mutex[nThreads];
+				threadsStatistics = new ThreadStatistics[nThreads];
+				for (int i=0; i<nThreads; i++) {
+					threadsStatistics[i].dispatchingNS      = 0;
+					threadsStatistics[i].dispatchingSinceNS = 0;
+					if (i >= minThreads) {
+						// threads beyond 'minThreads' start parked
+						parkingGuards[i].lock();
+					}
+				}
+			}
+
 			threads = new thread[nThreads+(debug ? 1 : 0)];
 
 			for (int i=0; i<nThreads; i++) {
+				if constexpr (std::is_move_assignable<std::remove_pointer_t<_AnswerTypePointer>>::value) {
+					// returning consumers may only be set for answers that can be assigned -- see 'QueueEventLink::setReturningConsumer(...)'
+					if ( zeroCopy && !consumeAnswerlessEvents && consumeAnswerfullEvents && (el.nReturningConsumers > 0) ) {
+						threads[i] = notifyEvents ? thread(&QueueEventDispatcher::dispatchReturningEventsLoop<true>,  this, i, i%el.nReturningConsumers)
+						                          : thread(&QueueEventDispatcher::dispatchReturningEventsLoop<false>, this, i, i%el.nReturningConsumers);
+						continue;
+					}
+				}
 				/**/ if ( zeroCopy &&  notifyEvents &&  consumeAnswerlessEvents && !consumeAnswerfullEvents )
-					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyListeneableAndConsumableAnswerlessEventsLoop, this, i, el.answerlessConsumerThese[i%el.nAnswerlessConsumerThese]);
+					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyEventsLoop<true,  true,  false>, this, i, i%el.nAnswerlessConsumers);
 				else if ( zeroCopy &&  notifyEvents && !consumeAnswerlessEvents &&  consumeAnswerfullEvents )
-					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyListeneableAndConsumableAnswerfullEventsLoop, this, i, el.answerfullConsumerThese[i%el.nAnswerfullConsumerThese]);
+					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyEventsLoop<true,  false, true>,  this, i, i%el.nAnswerfullConsumers);
 				else if ( zeroCopy && !notifyEvents &&  consumeAnswerlessEvents && !consumeAnswerfullEvents )
-					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyConsumableAnswerlessEventsLoop,               this, i, el.answerlessConsumerThese[i%el.nAnswerlessConsumerThese]);
+					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyEventsLoop<false, true,  false>, this, i, i%el.nAnswerlessConsumers);
 				else if ( zeroCopy && !notifyEvents && !consumeAnswerlessEvents &&  consumeAnswerfullEvents )
-					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyConsumableAnswerfullEventsLoop,               this, i, el.answerfullConsumerThese[i%el.nAnswerfullConsumerThese]);
+					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyEventsLoop<false, false, true>,  this, i, i%el.nAnswerfullConsumers);
 				else if ( zeroCopy &&  notifyEvents && !consumeAnswerlessEvents && !consumeAnswerfullEvents )
-					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyListeneableEventsLoop,                        this, i);
+					threads[i] = thread(&QueueEventDispatcher::dispatchZeroCopyEventsLoop<true,  false, false>, this, i, 0);
 				else
 	                THROW_EXCEPTION(invalid_argument, "QueueEventDispatcher: Attempting to create a dispatcher for event '"+el.eventName+"' with a not implemented combination of " +
 	                                                  "'zeroCopy' (" +                to_string(zeroCopy)+"), " +
 	                                                  "'notifyEvents' (" +            to_string(notifyEvents)+"), " +
 	                                                  "'consumeAnswerlessEvents' (" + to_string(consumeAnswerlessEvents)+") and " +
-	                                                  "'consumeAnswerfullEvents' (" + to_string(consumeAnswerfullEvents)+")");
+	                                                  "'consumeAnswerfullEvents' (" + to_string(consumeAnswerfullEvents)+") -- " +
+	                                                  "(you may use 'StaticQueueEventDispatcher' to have such combinations checked at compile time)");
 			}
 
 			// start debugger thread?
 			if (debug) {
+				debugTrackerGuard.lock();
 				threads[nThreads] = thread(&QueueEventDispatcher::debugTracker, this);
 			}
 
+			// start the autoscaler thread?
+			if (isAutoscaling) {
+				autoscalerGuard.lock();
+				autoscalerThread = thread(&QueueEventDispatcher::autoscaler, this);
+			}
+
 			setArgumentSerializer();
 		}
 
@@ -120,51 +216,26 @@ namespace mutua::events {
 		}
 
 		~QueueEventDispatcher() {
-
 			stopASAP();
+			delete[] threads;
+			delete[] parkingGuards;
+			delete[] threadsStatistics;
+		}
 
-			// we will now unlock all mutexes. this may cause false wakeups. to prevent
-			// calling listeners & consumers with wrong data, we will reset them
-			// note: we cannot help if any external thread is waiting for an answer -- a false wakeup will occur for them
-			// note 2: this wired mechanism is to prevent the usage of condition variables, which would produce false wakeups
-			//         and the need for (slow) code to deal with it.
-
-			// remove all listeners
-			el.nListenerProcedureReferences = 0;
-
-			// unset original & set dummy consumers to receive false wakeups
-			el.unsetConsumer();
-			el.setAnswerlessConsumer(&_QueueEventLink::dummyAnswerlessConsumer, {&el});
-			el.setAnswerfullConsumer(&_QueueEventLink::dummyAnswerfullConsumer, {&el});
-
-			// unlock any locked mutexes, allowing full & empty queue locks do proceed -- and wait a little until no mutex is locked again
-			mutex* guardMutexes[] = {&el.reservationGuard, &el.dequeueGuard, &el.queueGuard};
-			unsigned retries = 0;
-			while (retries < nThreads*5) {	// wait a minimum of ~ 40ms without any new locks on ~4 consumers
-				retries++;
-				for (unsigned i=0; i<sizeof(guardMutexes)/sizeof(guardMutexes[0]); i++) {
-					// prevent further lockings
-					el.isFull            = false;
-					el.isEmpty           = false;
-					el.queueHead         = 0;
-					el.queueTail         = 1;
-					el.queueReservedHead = 0;
-					el.queueReservedTail = 1;
-					if (isMutexLocked(*guardMutexes[i])) {
-						guardMutexes[i]->unlock();
-						retries = 0;
-					}
-				}
-				// unlock any answer mutexes
-				for (unsigned i=0; i<el.numberOfQueueSlots; i++) {
-					if (isMutexLocked(el.events[i].answerMutex)) {
-						el.events[i].answerMutex.unlock();
-					}
-				}
-				this_thread::sleep_for(chrono::milliseconds(2));
-			}
+		/** Opt-in hybrid execution: events reported while the queue is empty are dispatched right away on the producer thread,
+		 *  provided a consumer instance is free -- sparing the cross-thread wake up of a dispatcher thread, which costs far more
+		 *  than a fast consumer. Under load, events are queued as usual. See 'QueueEventLink::setInlineDispatcher(...)'.
+		 *  Must be called before any events are reported. Please note that, even with a single consumer instance, an event
+		 *  dispatched inline might get consumed before a previous event a dispatcher thread has just dequeued. */
+		void enableInlineWhenIdle() {
+			isInlineWhenIdle = true;
+			el.setInlineDispatcher(_QueueEventLink::InlineDispatcher::template fromMethod<&QueueEventDispatcher::dispatchInline>(this),
+			                       consumeAnswerlessEvents ? el.nAnswerlessConsumers : (consumeAnswerfullEvents ? el.nAnswerfullConsumers : 0));
+		}
 
-			delete[] threads;
+		/** The number of threads currently dispatching events -- fixed, unless in autoscaling mode */
+		int getNumberOfActiveThreads() {
+			return nActiveThreads;
 		}
 
 		inline bool isMutexLocked(mutex& m) {
@@ -173,194 +244,420 @@ namespace mutua::events {
 			return isLocked;
 		}
 
-		/** Cause all threads not to process any further elements from this point on */
-		void stopASAP() {
-			if (isActive) {
-				isActive = false;
-				for (int i=0; i<nThreads; i++) {
-					threads[i].detach();
-				}
-			}
+		/** Stops accepting new events on the link and causes all threads not to process any further elements from this point on:
+		 *  each thread finishes the event it is currently dispatching, if any, and is then joined -- so the shutdown time is bounded
+		 *  by the longest running consumer. Answerfull events left on the queue have their waiters woken up with an exception.
+		 *  Returns the number of leftover events: the ones queued but not dispatched + the ones reserved but not reported */
+		unsigned int stopASAP() {
+			isActive = false;
+			el.close();
+			return joinThreads();
 		}
 
-		/** Wait until queue is empty to stop all threads */
-		void stopWhenEmpty() {
-			int retries = 0;
-			int lastQueueHead         = el.queueHead;
-			int lastQueueTail         = el.queueTail;
-			int lastQueueReservedHead = el.queueReservedHead;
-			int lastQueueReservedTail = el.queueReservedTail;
-			while (retries < nThreads*5) {	// wait a minimum of ~ 40ms without any new events on ~4 consumers
-				if (el.isEmpty && (el.getQueueLength() == 0) && (el.getQueueReservedLength() == 0) &&
-					(lastQueueHead         == el.queueHead)         && (lastQueueTail         == el.queueTail) &&
-					(lastQueueReservedHead == el.queueReservedHead) && (lastQueueReservedTail == el.queueReservedTail)) {
-					retries++;
-				} else {
-					retries = 0;
-					lastQueueHead         = el.queueHead;
-					lastQueueTail         = el.queueTail;
-					lastQueueReservedHead = el.queueReservedHead;
-					lastQueueReservedTail = el.queueReservedTail;
-				}
-				this_thread::sleep_for(chrono::milliseconds(2));
+		/** Drain protocol: stops accepting new events on the link, lets the dispatcher threads consume whatever is already on the queue
+		 *  and then joins them -- so the shutdown time is bounded by the consumption of the events still queued, with no polling involved.
+		 *  Returns the number of leftover events: the ones reserved but not reported before the queue got drained */
+		unsigned int stopWhenEmpty() {
+			el.close();
+			return joinThreads();
+		}
+
+		/** Waits for the dispatcher threads to end -- which only happens after 'el' got closed -- then stops the debug tracker thread */
+		unsigned int joinThreads() {
+			if (areThreadsJoined) {
+				return nLeftoverEvents;
 			}
-			stopASAP();
+			if (isAutoscaling) {
+				// the autoscaler brings back any parked threads when leaving, so they may also see the closed link
+				autoscalerGuard.unlock();
+				autoscalerThread.join();
+			}
+			for (int i=0; i<nThreads; i++) {
+				threads[i].join();
+			}
+			if (isInlineWhenIdle) {
+				// only now: the dispatcher threads use the consumer instance guards up to their last event
+				el.unsetInlineDispatcher();
+			}
+			isActive = false;
+			if (debug) {
+				debugTrackerGuard.unlock();
+				threads[nThreads].join();
+			}
+			nLeftoverEvents  = el.discardLeftoverEvents();
+			areThreadsJoined = true;
+			return nLeftoverEvents;
 		}
 
 		inline void consumeAnswerlessEvent(
-				unsigned int                                                    threadId,
-				decltype(_QueueEventLink::answerlessConsumerProcedureReference) consumerMethod,
-				void*                                                           consumerThis,
-				const _ArgumentType&                                            eventParameter) {
+				unsigned int                                         threadId,
+				const typename _QueueEventLink::AnswerlessConsumer&  consumer,
+				unsigned int                                         consumerInstance,
+				const _ArgumentType&                                 eventParameter) {
 			try {
-				consumerMethod(consumerThis, eventParameter);
+				consumer(eventParameter);
 			} catch (const exception& e) {
 				DUMP_EXCEPTION(runtime_error("Exception in answerless consumer: "s + e.what()),
-						       "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerless consumer " +
+						       "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerless consumer instance #"+to_string(consumerInstance)+" " +
 					           "with parameter: "+eventParameterToStringSerializer(eventParameter)+". Event consumption will not be retried, " +
 					           "since a fall-back queue is not yet implemented.\n" +
 				               "Caused by: "+e.what(),
-				               "threadId",       to_string(threadId),
-				               "consumerMethod", to_string((size_t)consumerMethod),
-				               "consumerThis",   to_string((size_t)consumerThis),
-				               "eventParameter", eventParameterToStringSerializer(eventParameter));
+				               "threadId",         to_string(threadId),
+				               "consumerInstance", to_string(consumerInstance),
+				               "eventParameter",   eventParameterToStringSerializer(eventParameter));
 			} catch (...) {
 				DUMP_EXCEPTION(runtime_error("Unknown exception in answerless consumer"),
-				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerless consumer " +
+				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerless consumer instance #"+to_string(consumerInstance)+" " +
 				               "with parameter: "+eventParameterToStringSerializer(eventParameter)+". Event consumption will not be retried, " +
 				               "since a fall-back queue is not yet implemented.\n" +
 				               "Caused by: <<unknown cause>>",
-				               "threadId",       to_string(threadId),
-				               "consumerMethod", to_string((size_t)consumerMethod),
-				               "consumerThis",   to_string((size_t)consumerThis),
-				               "eventParameter", eventParameterToStringSerializer(eventParameter));
+				               "threadId",         to_string(threadId),
+				               "consumerInstance", to_string(consumerInstance),
+				               "eventParameter",   eventParameterToStringSerializer(eventParameter));
 			}
 		}
 
 		inline void consumeAnswerfullEvent(
-				unsigned int                                                    threadId,
-				decltype(_QueueEventLink::answerfullConsumerProcedureReference) consumerMethod,
-				void*                                                           consumerThis,
-				typename _QueueEventLink::QueueElement*                         dequeuedEvent) {
+				unsigned int                                         threadId,
+				const typename _QueueEventLink::AnswerfullConsumer&  consumer,
+				unsigned int                                         consumerInstance,
+				typename _QueueEventLink::QueueElement*              dequeuedEvent) {
 			try {
-				consumerMethod(consumerThis, dequeuedEvent->eventParameter, dequeuedEvent->answerObjectReference, dequeuedEvent->answerMutex);
+				consumer(dequeuedEvent->eventParameter, dequeuedEvent->answerObjectReference, dequeuedEvent->answerMutex);
 			} catch (const exception& e) {
 				dequeuedEvent->exception = std::current_exception();
 				DUMP_EXCEPTION(runtime_error("Exception in answerfull consumer: "s + e.what()),
-				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerfull consumer " +
+				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerfull consumer instance #"+to_string(consumerInstance)+" " +
 				               "with parameter: "+eventParameterToStringSerializer(dequeuedEvent->eventParameter)+". Event consumption will not be retried, " +
 				               "since a fall-back queue is not yet implemented.\n" +
 				               "Caused By: "+e.what(),
 				               "threadId",              to_string(threadId),
-				               "consumerMethod",        to_string((size_t)consumerMethod),
-				               "consumerThis",          to_string((size_t)consumerThis),
+				               "consumerInstance",      to_string(consumerInstance),
 				               "answerObjectReference", to_string((size_t)dequeuedEvent->answerObjectReference),
 				               "eventParameter",        eventParameterToStringSerializer(dequeuedEvent->eventParameter));
 			} catch (...) {
 				dequeuedEvent->exception = std::current_exception();
 				DUMP_EXCEPTION(runtime_error("Unknown exception in answerless consumer"),
-				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerfull consumer " +
+				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in answerfull consumer instance #"+to_string(consumerInstance)+" " +
 				               "with parameter: "+eventParameterToStringSerializer(dequeuedEvent->eventParameter)+". Event consumption will not be retried, " +
 				               "since a fall-back queue is not yet implemented.\n" +
 				               "Caused By: <<unknown cause>>",
 				               "threadId",              to_string(threadId),
-				               "consumerMethod",        to_string((size_t)consumerMethod),
-				               "consumerThis",          to_string((size_t)consumerThis),
+				               "consumerInstance",      to_string(consumerInstance),
 				               "answerObjectReference", to_string((size_t)dequeuedEvent->answerObjectReference),
 				               "eventParameter",        eventParameterToStringSerializer(dequeuedEvent->eventParameter));
-
-				// prepare the exception to be visible when the caller issues an 'waitForAnswer'
-				if (isMutexLocked(dequeuedEvent->answerMutex)) {
-					// the exception happened before the answer was issued
-					dequeuedEvent->answerObjectReference = nullptr;
-					dequeuedEvent->answerMutex.unlock();
-				}
 			}
+			// prepare the exception to be visible when the caller issues an 'waitForAnswer'
+			if ( (dequeuedEvent->exception != nullptr) && isMutexLocked(dequeuedEvent->answerMutex) ) {
+				// the exception happened before the answer was issued
+				dequeuedEvent->answerObjectReference = nullptr;
+				dequeuedEvent->answerMutex.unlock();
+			}
+			// resume any coroutine awaiting the answer
+			el.completeAnswerfullEvent(*dequeuedEvent);
 		}
 
 		inline void notifyEventObservers(
-				unsigned int                                           threadId,
-				decltype(_QueueEventLink::listenerProcedureReferences) listenerMethods,
-				void*                                                 *listenersThis,
-				const _ArgumentType&                                   eventParameter) {
-			for (unsigned int i=0; i<el.nListenerProcedureReferences; i++) try {
-				listenerMethods[i](listenersThis[i], eventParameter);
+				unsigned int                                         threadId,
+				const typename _QueueEventLink::Listener*            listeners,
+				const _ArgumentType&                                 eventParameter) {
+			for (unsigned int i=0; i<el.nListeners; i++) try {
+				listeners[i](eventParameter);
 			} catch (const exception& e) {
 				DUMP_EXCEPTION(runtime_error("Exception in listener: "s + e.what()),
 				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in event listener #"+to_string(i)+
 				               "with parameter: "+eventParameterToStringSerializer(eventParameter)+".\n" +
 				               "Caused by: "+e.what(),
-				               "threadId",                         to_string(threadId),
-				               "listenerMethod["+to_string(i)+"]", to_string((size_t)listenerMethods[i]),
-				               "listenerThis["+to_string(i)+"]",   to_string((size_t)listenersThis[i]),
-				               "eventParameter",                   eventParameterToStringSerializer(eventParameter));
+				               "threadId",       to_string(threadId),
+				               "eventParameter", eventParameterToStringSerializer(eventParameter));
 			} catch (...) {
 				std::exception_ptr e = std::current_exception();
 				DUMP_EXCEPTION(runtime_error("Unknown Exception in listener"),
 				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in event listener #"+to_string(i)+
 				               "with parameter: "+eventParameterToStringSerializer(eventParameter)+".\n" +
 				               "Caused by: <<unknown cause>>",
-				               "threadId",                         to_string(threadId),
-				               "listenerMethod["+to_string(i)+"]", to_string((size_t)listenerMethods[i]),
-				               "listenerThis["+to_string(i)+"]",   to_string((size_t)listenersThis[i]),
-				               "eventParameter",                   eventParameterToStringSerializer(eventParameter));
+				               "threadId",       to_string(threadId),
+				               "eventParameter", eventParameterToStringSerializer(eventParameter));
 			}
 		}
 
-		// if (zeroCopy && notifyEvents &&  consumeAnswerlessEvents && !consumeAnswerfullEvents)
-		void dispatchZeroCopyListeneableAndConsumableAnswerlessEventsLoop(int threadId, void* consumerThis) {
+		/** The dispatching loop, with the dispatching policies resolved at compile time -- each combination of
+		 *  '_NotifyEvents', '_ConsumeAnswerlessEvents' & '_ConsumeAnswerfullEvents' gets its own specialized loop,
+		 *  with no runtime branches deciding what to do with each dequeued event.
+		 *  See 'StaticQueueEventDispatcher' for a version where the consumer method is also known at compile time. */
+		template <bool _NotifyEvents, bool _ConsumeAnswerlessEvents, bool _ConsumeAnswerfullEvents>
+		void dispatchZeroCopyEventsLoop(int threadId, unsigned int consumerInstance) {
+			static_assert(!(_ConsumeAnswerlessEvents && _ConsumeAnswerfullEvents), "QueueEventDispatcher: an event link may not have both answerless and answerfull events consumed by the same dispatcher");
+			static_assert(_NotifyEvents || _ConsumeAnswerlessEvents || _ConsumeAnswerfullEvents, "QueueEventDispatcher: nothing to dispatch");
 			typename _QueueEventLink::QueueElement* dequeuedEvent;
 			int                                     eventId;
 			while (isActive) {
+				if (isAutoscaling && (threadId >= nActiveThreads)) {
+					parkingGuards[threadId].lock();
+					parkingGuards[threadId].unlock();
+					continue;
+				}
 				eventId = el.reserveEventForDispatching(dequeuedEvent);
-				consumeAnswerlessEvent(threadId, el.answerlessConsumerProcedureReference, consumerThis,     dequeuedEvent->eventParameter);
-				notifyEventObservers  (threadId, el.listenerProcedureReferences,          el.listenersThis, dequeuedEvent->eventParameter);
+				if (eventId == -1) {
+					// the link was closed & drained
+					break;
+				}
+				if (isAutoscaling) {
+					threadsStatistics[threadId].dispatchingSinceNS.store(getMonotonicTimeNS(), memory_order_relaxed);
+				}
+				if (isInlineWhenIdle && (el.nConsumerInstanceGuards > 0)) {
+					// producers may be using our consumer instance to dispatch inline
+					el.consumerInstanceGuards[consumerInstance].lock();
+					dispatchEvent<_NotifyEvents, _ConsumeAnswerlessEvents, _ConsumeAnswerfullEvents>(threadId, consumerInstance, dequeuedEvent);
+					el.consumerInstanceGuards[consumerInstance].unlock();
+				} else {
+					dispatchEvent<_NotifyEvents, _ConsumeAnswerlessEvents, _ConsumeAnswerfullEvents>(threadId, consumerInstance, dequeuedEvent);
+				}
 				el.releaseEvent(eventId);
+				if (isAutoscaling) {
+					ThreadStatistics& statistics = threadsStatistics[threadId];
+					statistics.dispatchingNS.store(statistics.dispatchingNS.load(memory_order_relaxed) + getMonotonicTimeNS() - statistics.dispatchingSinceNS.load(memory_order_relaxed), memory_order_relaxed);
+					statistics.dispatchingSinceNS.store(0, memory_order_relaxed);
+				}
 			}
 		}
 
-		// if (zeroCopy && notifyEvents && !consumeAnswerlessEvents &&  consumeAnswerfullEvents)
-		void dispatchZeroCopyListeneableAndConsumableAnswerfullEventsLoop(int threadId, void* consumerThis) {
-			typename _QueueEventLink::QueueElement* dequeuedEvent;
-			int                                     eventId;
-			while (isActive) {
-				eventId = el.reserveEventForDispatching(dequeuedEvent);
-				consumeAnswerfullEvent(threadId, el.answerfullConsumerProcedureReference, consumerThis,     dequeuedEvent);
-				notifyEventObservers  (threadId, el.listenerProcedureReferences,          el.listenersThis, dequeuedEvent->eventParameter);
-				el.releaseEvent(eventId);
+		/** Wakes whoever is waiting for the answer of 'event', after a returning consumer stored it (see 'consumeReturningEvent(...)') */
+		inline void publishAnswer(typename _QueueEventLink::QueueElement& event) {
+			event.answerMutex.unlock();
+			el.completeAnswerfullEvent(event);
+		}
+
+		/** Calls a returning consumer, storing the answer -- which is not published here. Returns false if the consumer failed */
+		inline bool consumeReturningEvent(
+				unsigned int                                         threadId,
+				const typename _QueueEventLink::ReturningConsumer&   consumer,
+				unsigned int                                         consumerInstance,
+				typename _QueueEventLink::QueueElement*              dequeuedEvent) {
+			try {
+				if (dequeuedEvent->answerObjectReference == nullptr) {
+					// reserved as answerless
+					consumer(dequeuedEvent->eventParameter);
+				} else {
+					*dequeuedEvent->answerObjectReference = consumer(dequeuedEvent->eventParameter);
+				}
+				return true;
+			} catch (const exception& e) {
+				dequeuedEvent->exception = std::current_exception();
+				DUMP_EXCEPTION(runtime_error("Exception in returning consumer: "s + e.what()),
+				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in returning consumer instance #"+to_string(consumerInstance)+" " +
+				               "with parameter: "+eventParameterToStringSerializer(dequeuedEvent->eventParameter)+". Event consumption will not be retried, " +
+				               "since a fall-back queue is not yet implemented.\n" +
+				               "Caused By: "+e.what(),
+				               "threadId",              to_string(threadId),
+				               "consumerInstance",      to_string(consumerInstance),
+				               "answerObjectReference", to_string((size_t)dequeuedEvent->answerObjectReference),
+				               "eventParameter",        eventParameterToStringSerializer(dequeuedEvent->eventParameter));
+			} catch (...) {
+				dequeuedEvent->exception = std::current_exception();
+				DUMP_EXCEPTION(runtime_error("Unknown exception in returning consumer"),
+				               "QueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in returning consumer instance #"+to_string(consumerInstance)+" " +
+				               "with parameter: "+eventParameterToStringSerializer(dequeuedEvent->eventParameter)+". Event consumption will not be retried, " +
+				               "since a fall-back queue is not yet implemented.\n" +
+				               "Caused By: <<unknown cause>>",
+				               "threadId",              to_string(threadId),
+				               "consumerInstance",      to_string(consumerInstance),
+				               "answerObjectReference", to_string((size_t)dequeuedEvent->answerObjectReference),
+				               "eventParameter",        eventParameterToStringSerializer(dequeuedEvent->eventParameter));
 			}
+			return false;
 		}
 
-		// if ( zeroCopy && !notifyEvents &&  consumeAnswerlessEvents && !consumeAnswerfullEvents)
-		void dispatchZeroCopyConsumableAnswerlessEventsLoop(int threadId, void* consumerThis) {
-			typename _QueueEventLink::QueueElement* dequeuedEvent;
-			int                                     eventId;
+		/** The dispatching loop for links with returning consumers (see 'QueueEventLink::setReturningConsumer(...)'): up to
+		 *  'returningEventsBatchSize' events are dequeued at once -- but no more than this thread's share of the queued events,
+		 *  so the other active threads aren't left idle -- and consumed in order. The queue is locked once per batch, rather than
+		 *  twice per event, and the answers are published in a single pass once the batch is consumed -- or earlier, as soon as the
+		 *  oldest unpublished one has waited for 'returningAnswersMaxDelayNS', so slow consumers don't hold back the answers produced
+		 *  before them for longer than the one being consumed. */
+		template <bool _NotifyEvents>
+		void dispatchReturningEventsLoop(int threadId, unsigned int consumerInstance) {
+			int                                     firstEventId;
+			unsigned int                            nEvents;
+			typename _QueueEventLink::QueueElement* unpublishedAnswers[returningEventsBatchSize];
+			unsigned int                            nUnpublishedAnswers = 0;
+			unsigned long long                      firstUnpublishedAnswerNS = 0;
+			auto publishAnswers = [this, &unpublishedAnswers, &nUnpublishedAnswers]() {
+				for (unsigned int i=0; i<nUnpublishedAnswers; i++) {
+					publishAnswer(*unpublishedAnswers[i]);
+				}
+				nUnpublishedAnswers = 0;
+			};
 			while (isActive) {
-				eventId = el.reserveEventForDispatching(dequeuedEvent);
-				consumeAnswerlessEvent(threadId, el.answerlessConsumerProcedureReference, consumerThis, dequeuedEvent->eventParameter);
-				el.releaseEvent(eventId);
+				if (isAutoscaling && (threadId >= nActiveThreads)) {
+					parkingGuards[threadId].lock();
+					parkingGuards[threadId].unlock();
+					continue;
+				}
+				nEvents = el.reserveEventsForDispatching(firstEventId, returningEventsBatchSize, isAutoscaling ? nActiveThreads.load(memory_order_relaxed) : nThreads);
+				if (nEvents == 0) {
+					// the link was closed & drained
+					break;
+				}
+				if (isAutoscaling) {
+					threadsStatistics[threadId].dispatchingSinceNS.store(getMonotonicTimeNS(), memory_order_relaxed);
+				}
+				bool isHoldingConsumerInstance = isInlineWhenIdle && (el.nConsumerInstanceGuards > 0);
+				if (isHoldingConsumerInstance) {
+					// producers may be using our consumer instance to dispatch inline
+					el.consumerInstanceGuards[consumerInstance].lock();
+				}
+				// consume
+				for (unsigned int i=0; i<nEvents; i++) {
+					typename _QueueEventLink::QueueElement& batchEvent = el.events[(firstEventId+i) & _QueueEventLink::queueSlotsModulus];
+					el.dispatchDequeuedEvent(batchEvent, [this, threadId, consumerInstance, &batchEvent, &unpublishedAnswers, &nUnpublishedAnswers, &firstUnpublishedAnswerNS]
+					                                     (typename _QueueEventLink::QueueElement& event) {
+						bool isAnswerfull = event.answerObjectReference != nullptr;
+						if (!consumeReturningEvent(threadId, el.returningConsumers[consumerInstance], consumerInstance, &event) && isAnswerfull) {
+							// the answer was not produced: have the exception rethrown by 'waitForAnswer'
+							event.answerObjectReference = nullptr;
+						}
+						if (isAnswerfull) {
+							if (&event == &batchEvent) {
+								// published along with the batch, which is released only afterwards
+								if (nUnpublishedAnswers == 0) {
+									firstUnpublishedAnswerNS = getMonotonicTimeNS();
+								}
+								unpublishedAnswers[nUnpublishedAnswers++] = &event;
+							} else {
+								// events deferred by a key lane are released by the lane holder right after being dispatched
+								publishAnswer(event);
+							}
+						}
+						if constexpr (_NotifyEvents) {
+							notifyEventObservers(threadId, el.listeners, event.eventParameter);
+						}
+					});
+					if ( (nUnpublishedAnswers > 0) && (getMonotonicTimeNS() - firstUnpublishedAnswerNS >= returningAnswersMaxDelayNS) ) {
+						publishAnswers();
+					}
+				}
+				publishAnswers();
+				if (isHoldingConsumerInstance) {
+					el.consumerInstanceGuards[consumerInstance].unlock();
+				}
+				el.releaseEvents(firstEventId, nEvents);
+				if (isAutoscaling) {
+					ThreadStatistics& statistics = threadsStatistics[threadId];
+					statistics.dispatchingNS.store(statistics.dispatchingNS.load(memory_order_relaxed) + getMonotonicTimeNS() - statistics.dispatchingSinceNS.load(memory_order_relaxed), memory_order_relaxed);
+					statistics.dispatchingSinceNS.store(0, memory_order_relaxed);
+				}
 			}
 		}
 
-		// if ( zeroCopy && !notifyEvents && !consumeAnswerlessEvents &&  consumeAnswerfullEvents )
-		void dispatchZeroCopyConsumableAnswerfullEventsLoop(int threadId, void* consumerThis) {
-			typename _QueueEventLink::QueueElement* dequeuedEvent;
-			int                                     eventId;
-			while (isActive) {
-				eventId = el.reserveEventForDispatching(dequeuedEvent);
-				consumeAnswerfullEvent(threadId, el.answerfullConsumerProcedureReference, consumerThis, dequeuedEvent);
-				el.releaseEvent(eventId);
+		/** Consumes & notifies a single event, according to the dispatching policies -- unless it was cancelled, expired or deferred
+		 *  to the thread holding its key lane (see 'QueueEventLink::dispatchDequeuedEvent(...)') */
+		template <bool _NotifyEvents, bool _ConsumeAnswerlessEvents, bool _ConsumeAnswerfullEvents>
+		inline void dispatchEvent(unsigned int threadId, unsigned int consumerInstance, typename _QueueEventLink::QueueElement* dequeuedEvent) {
+			el.dispatchDequeuedEvent(*dequeuedEvent, [this, threadId, consumerInstance](typename _QueueEventLink::QueueElement& event) {
+				if constexpr (_ConsumeAnswerlessEvents) {
+					consumeAnswerlessEvent(threadId, el.answerlessConsumers[consumerInstance], consumerInstance, event.eventParameter);
+				}
+				if constexpr (_ConsumeAnswerfullEvents) {
+					consumeAnswerfullEvent(threadId, el.answerfullConsumers[consumerInstance], consumerInstance, &event);
+				}
+				if constexpr (_NotifyEvents) {
+					notifyEventObservers(threadId, el.listeners, event.eventParameter);
+				}
+			});
+		}
+
+		/** Called by the link, on the producer thread, to dispatch an event inline -- see 'enableInlineWhenIdle()'.
+		 *  Reported as thread #'nThreads' on exception dumps */
+		void dispatchInline(typename _QueueEventLink::QueueElement* event, unsigned int consumerInstance) {
+			/**/ if ( notifyEvents &&  consumeAnswerlessEvents) dispatchEvent<true,  true,  false>(nThreads, consumerInstance, event);
+			else if ( notifyEvents &&  consumeAnswerfullEvents) dispatchEvent<true,  false, true> (nThreads, consumerInstance, event);
+			else if (!notifyEvents &&  consumeAnswerlessEvents) dispatchEvent<false, true,  false>(nThreads, consumerInstance, event);
+			else if (!notifyEvents &&  consumeAnswerfullEvents) dispatchEvent<false, false, true> (nThreads, consumerInstance, event);
+			else                                                dispatchEvent<true,  false, false>(nThreads, consumerInstance, event);
+		}
+
+		static inline unsigned long long getMonotonicTimeNS() {
+			return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static unsigned long long getThreadCPUTimeNS(thread& t) {
+			clockid_t       clockId;
+			struct timespec cpuTime;
+			if ( (pthread_getcpuclockid(t.native_handle(), &clockId) != 0) || (clock_gettime(clockId, &cpuTime) != 0) ) {
+				return 0;
 			}
+			return (unsigned long long)cpuTime.tv_sec * 1'000'000'000ull + (unsigned long long)cpuTime.tv_nsec;
 		}
 
-		// if ( zeroCopy &&  notifyEvents && !consumeAnswerlessEvents && !consumeAnswerfullEvents )
-		void dispatchZeroCopyListeneableEventsLoop(int threadId) {
-			typename _QueueEventLink::QueueElement* dequeuedEvent;
-			int                                     eventId;
-			while (isActive) {
-				eventId = el.reserveEventForDispatching(dequeuedEvent);
-				notifyEventObservers(threadId, el.listenerProcedureReferences, el.listenersThis, dequeuedEvent->eventParameter);
-				el.releaseEvent(eventId);
+		/** Adds or parks dispatcher threads, as described on the autoscaling constructor. Only this thread changes 'nActiveThreads':
+		 *  to park thread 'n-1', its parking guard is locked before 'nActiveThreads' is decremented; to bring thread 'n' back,
+		 *  'nActiveThreads' is incremented before its parking guard is unlocked */
+		void autoscaler() {
+			vector<unsigned long long> lastDispatchingNS(nThreads, 0);
+			vector<unsigned long long> lastCPUNS(nThreads, 0);
+			unsigned long long         lastSampleNS       = getMonotonicTimeNS();
+			unsigned int               nIdleSamples       = 0;
+			unsigned int               nCores             = thread::hardware_concurrency();
+			for (int i=0; i<nThreads; i++) {
+				lastCPUNS[i] = getThreadCPUTimeNS(threads[i]);
+			}
+			while (true) {
+				// sleep for an interval -- or until 'joinThreads()' unlocks the guard
+				if (autoscalerGuard.try_lock_for(autoscalingInterval)) {
+					autoscalerGuard.unlock();
+					break;
+				}
+
+				// sample
+				unsigned long long nowNS         = getMonotonicTimeNS();
+				unsigned long long elapsedNS     = nowNS - lastSampleNS;
+				unsigned long long dispatchingNS = 0;	// wall time the active threads spent on consumers & listeners
+				unsigned long long cpuNS         = 0;	// CPU time the active threads used
+				int                n             = nActiveThreads;
+				for (int i=0; i<nThreads; i++) {
+					// the event being dispatched right now is accounted up to this moment (an approximation, since this is not synchronized with the dispatcher thread)
+					unsigned long long sinceNS          = threadsStatistics[i].dispatchingSinceNS.load(memory_order_relaxed);
+					unsigned long long totalDispatching = threadsStatistics[i].dispatchingNS.load(memory_order_relaxed) + ((sinceNS != 0) && (sinceNS < nowNS) ? nowNS - sinceNS : 0);
+					unsigned long long totalCPU         = getThreadCPUTimeNS(threads[i]);
+					if (i < n) {
+						dispatchingNS += totalDispatching > lastDispatchingNS[i] ? totalDispatching - lastDispatchingNS[i] : 0;
+						cpuNS         += totalCPU         > lastCPUNS[i]         ? totalCPU         - lastCPUNS[i]         : 0;
+					}
+					lastDispatchingNS[i] = totalDispatching;
+					lastCPUNS[i]         = totalCPU;
+				}
+				lastSampleNS = nowNS;
+				unsigned long long waitingNS   = elapsedNS*n > dispatchingNS ? elapsedNS*n - dispatchingNS : 0;	// idle time: waiting for events
+				unsigned long long blockedNS   = dispatchingNS > cpuNS       ? dispatchingNS - cpuNS       : 0;	// consumers off-CPU time
+				unsigned int       queueLength = el.getQueueLength();
+
+				bool isSaturated    = waitingNS*10 < dispatchingNS;		// active threads are dispatching more than ~90% of the time
+				bool isUnderused    = waitingNS    > dispatchingNS;		// active threads are waiting for events more than half of the time
+				bool isBlocked      = blockedNS*4  > dispatchingNS;		// consumers are off-CPU more than a quarter of their time
+				bool hasSpareCores  = (nCores == 0) || ((unsigned int)n < nCores);
+
+				if ( (queueLength > 0) && isSaturated && (isBlocked || hasSpareCores) && (n < nThreads) ) {
+					// add a thread
+					nActiveThreads = n+1;
+					parkingGuards[n].unlock();
+					nIdleSamples = 0;
+				} else if ( (queueLength == 0) && isUnderused && (n > minThreads) ) {
+					if (++nIdleSamples >= idleSamplesToPark) {
+						// park a thread
+						parkingGuards[n-1].lock();
+						nActiveThreads = n-1;
+						nIdleSamples = 0;
+					}
+				} else {
+					nIdleSamples = 0;
+				}
+			}
+
+			// bring all parked threads back, so they can see the link was closed or that we are no longer active
+			int n = nActiveThreads;
+			nActiveThreads = nThreads;
+			for (int i=n; i<nThreads; i++) {
+				parkingGuards[i].unlock();
 			}
 		}
 
@@ -384,7 +681,11 @@ namespace mutua::events {
 				if (!isDequeueGuardLocked)     el.dequeueGuard.unlock();
 
 				cerr << "\nQueueEventDispatcher('" << el.eventName << "'): rHead=" << el.queueReservedHead << "; rTail=" << el.queueReservedTail << "; reservedLength: " << el.getQueueReservedLength() << " | qHead=" << el.queueHead << "; qTail=" << el.queueTail << "; queueLength: " << el.getQueueLength() << " | isReservationGuardLocked=" << isReservationGuardLocked << "; isFull=" << isFull << "; isQueueGuardLocked=" << isQueueGuardLocked << "; isDequeueGuardLocked=" << isDequeueGuardLocked << "; isEmpty=" << isEmpty << endl << flush;
-				this_thread::sleep_for(chrono::milliseconds(1000));
+				// sleep for a second -- or until 'joinThreads()' unlocks the guard
+				if (debugTrackerGuard.try_lock_for(chrono::milliseconds(1000))) {
+					debugTrackerGuard.unlock();
+					break;
+				}
 			}
 		}
 	};
@@ -3,17 +3,55 @@
 
 #include <iostream>
 #include <mutex>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <coroutine>
 using namespace std;
 
 #include <BetterExceptions.h>
 //using namespace mutua::cpputils;
 
+#include "EventDelegate.h"
+
 
 // linux kernel macros for optimizing branch instructions
 #define likely(x)       __builtin_expect((x),1)
 #define unlikely(x)     __builtin_expect((x),0)
 
 namespace mutua::events {
+
+	/** Dispatching states of each event -- see 'QueueEventLink::cancelEvent(...)' */
+	enum class EventDispatchState : uint8_t {QUEUED, RUNNING, CANCELLATION_REQUESTED, CANCELLING, CANCELLED, DISPATCHED};
+
+	/** What waiters of events cancelled before being consumed get thrown at */
+	struct EventCancelled: public runtime_error {
+		using runtime_error::runtime_error;
+	};
+
+	/** What waiters of events whose deadline passed before they could be consumed get thrown at -- see 'QueueEventLink::setEventsTimeToLive(...)' */
+	struct EventExpired: public EventCancelled {
+		using EventCancelled::EventCancelled;
+	};
+
+	/** What reporters get thrown at when the admission control rejects their events -- and what waiters of diverted events get thrown at.
+	 *  See 'QueueEventLink::setAdmissionControl(...)' */
+	struct EventRejected: public runtime_error {
+		using runtime_error::runtime_error;
+	};
+
+	/** What to do with events reported above the rate allowed by 'QueueEventLink::setAdmissionControl(...)' */
+	enum class AdmissionPolicy : uint8_t {REJECT, DELAY, DIVERT};
+
+	/** The dispatching state of the event being consumed by the current thread -- see 'isCurrentEventCancelled()' */
+	inline thread_local const atomic<EventDispatchState>* currentEventDispatchState = nullptr;
+
+	/** Cancellation token: long running consumers may poll it to know if they should give up on the event they are consuming */
+	inline bool isCurrentEventCancelled() {
+		const atomic<EventDispatchState>* dispatchState = currentEventDispatchState;
+		return (dispatchState != nullptr) && (dispatchState->load(memory_order_relaxed) == EventDispatchState::CANCELLATION_REQUESTED);
+	}
+
     /**
      * QueueEventLink.h
      * ================
@@ -32,6 +70,12 @@ namespace mutua::events {
     	constexpr static unsigned int numberOfQueueSlots = (unsigned int) 1 << (unsigned int) _Log2_QueueSlots;
     	constexpr static unsigned int queueSlotsModulus  = numberOfQueueSlots-1;
 
+        // answerfull events completion states -- see 'completeAnswerfullEvent(...)'
+        enum CompletionState : uint8_t {PENDING, SETTING_CONTINUATION, CONTINUATION_SET, COMPLETED};
+        typedef EventDelegate<void ()> Continuation;
+        // answer continuations -- called with the event parameter, the answer (nullptr if the consumer failed before answering) & the consumer exception, if any
+        typedef EventDelegate<void (const _ArgumentType&, _AnswerType*, const exception_ptr&)> AnswerHandler;
+
         // queue elements
         struct QueueElement {
             _ArgumentType   eventParameter;
@@ -39,27 +83,140 @@ namespace mutua::events {
             _AnswerType*    answerObjectReference;
             mutex           answerMutex;
             exception_ptr   exception;
+            atomic<uint8_t> completionState;	// see 'CompletionState' -- the continuation, if any, is on 'continuations'
+            atomic<EventDispatchState> dispatchState;	// see 'cancelEvent(...)'
+            bool            hasAnswerHandler;	// if set, the answer goes to the slot's 'answerHandlers' entry
             // reserved queue vs completed queue synchronization
             bool            reserved;		// keeps track of the conceded but not yet enqueued & conceded but not yet dequeued slots
+            // note: the state of optional features lives on side arrays, allocated only when the feature is used -- keeping slots small
 
             QueueElement()
             		: answerObjectReference(nullptr)
                     , exception(nullptr)
+                    , completionState(COMPLETED)
+                    , dispatchState(EventDispatchState::DISPATCHED)
+                    , hasAnswerHandler(false)
             		, reserved(false) {}
         };
 
-        // consumers
-        void       (*answerlessConsumerProcedureReference) (void*, const _ArgumentType&);
-        void*       *answerlessConsumerThese;   // pointers to instances (this) of the class on which the method 'answerlessConsumerProcedureReference' will act on
-        unsigned int nAnswerlessConsumerThese;
-        void       (*answerfullConsumerProcedureReference) (void*, const _ArgumentType&, _AnswerType*, std::mutex&);
-        void*       *answerfullConsumerThese;   // pointers to instances (this) of the class on which the method 'answerfullConsumerProcedureReference' will act on
-        unsigned int nAnswerfullConsumerThese;
+        // consumers & listeners are referenced through delegates -- see 'EventDelegate.h'
+        typedef EventDelegate<void (const _ArgumentType&)>                           AnswerlessConsumer;
+        typedef EventDelegate<void (const _ArgumentType&, _AnswerType*, std::mutex&)> AnswerfullConsumer;
+        typedef EventDelegate<void (const _ArgumentType&)>                           Listener;
+        typedef EventDelegate<_AnswerType (const _ArgumentType&)>                    ReturningConsumer;	// answerfull consumers returning the answer -- see 'setReturningConsumer(...)'
+        typedef EventDelegate<void (const _ArgumentType&, _AnswerType&)>             StreamingConsumer;	// answerfull consumers filling an 'AnswerStream' -- see 'setStreamingConsumer(...)'
+
+        // consumers -- each element of the arrays is an instance on the consumer pool: no two dispatcher threads will use the same element at the same time
+        AnswerlessConsumer* answerlessConsumers;
+        unsigned int        nAnswerlessConsumers;
+        AnswerfullConsumer* answerfullConsumers;
+        unsigned int        nAnswerfullConsumers;
+        ReturningConsumer*  returningConsumers;		// if set, 'answerfullConsumers' are adapters to these
+        unsigned int        nReturningConsumers;
+        StreamingConsumer*  streamingConsumers;		// same as above
+        unsigned int        nStreamingConsumers;
 
         // listeners
-        void       (*listenerProcedureReferences[_NListeners]) (void*, const _ArgumentType&);
-        void*        listenersThis[_NListeners];
-        unsigned int nListenerProcedureReferences;
+        Listener     listeners[_NListeners];
+        unsigned int nListeners;
+
+        // coroutines awaiting answers are resumed through this executor -- or on the thread completing the event, if not set. See 'answer(...)'
+        typedef EventDelegate<void (std::coroutine_handle<>)> CoroutineExecutor;
+        CoroutineExecutor coroutineExecutor;
+
+        // per link answer continuation -- see 'setAnswerHandler(...)'
+        AnswerHandler answerHandler;
+        // continuations & answer handlers of each slot -- allocated on first use
+        Continuation*  continuations;
+        once_flag      continuationsAllocation;
+        AnswerHandler* answerHandlers;
+        once_flag      answerHandlersAllocation;
+        // answer storage for events reported with an answer handler but without an 'answerObjectReference' -- one per slot, allocated on first use
+        _AnswerType*  handlerAnswers;
+        once_flag     handlerAnswersAllocation;
+
+        // inline-when-idle hybrid execution -- see 'setInlineDispatcher(...)'
+        typedef EventDelegate<void (QueueElement*, unsigned int)> InlineDispatcher;	// consumes & notifies the given event using the given consumer instance
+        InlineDispatcher inlineDispatcher;
+        mutex*           consumerInstanceGuards;		// one per consumer instance -- held by whichever thread (dispatcher or producer) is using it
+        unsigned int     nConsumerInstanceGuards;
+
+        // expiry based load shedding -- see 'setEventsTimeToLive(...)'
+        unsigned long long         eventsTimeToLiveNS;		// 0: events never expire
+        unsigned long long*        deadlines;				// the deadline of each slot, 0 if the event never expires -- nullptr if expiration is disabled
+        Listener                   expiredEventsListener;
+        atomic<unsigned long long> nExpiredEvents;
+
+        // single flight (collapsing of identical answerfull events) -- see 'setSingleFlight(...)'
+        typedef EventDelegate<size_t (const _ArgumentType&)>                      ParameterHasher;
+        typedef EventDelegate<bool (const _ArgumentType&, const _ArgumentType&)> ParameterComparator;
+        struct FlightPassenger {	// a reporter attached to an in flight event -- lives on its stack
+            _AnswerType*     answerObjectReference;
+            mutex            landingGuard;		// locked until the answer is copied into 'answerObjectReference'
+            exception_ptr    exception;
+            FlightPassenger* next;
+        };
+        struct Flight {				// an answerfull event being reported, queued or consumed on behalf of all reporters of an identical parameter
+            size_t               parameterHash;
+            const _ArgumentType* eventParameter;
+            FlightPassenger*     passengers;
+            Flight*              next;
+        };
+        ParameterHasher     flightParameterHasher;
+        ParameterComparator flightParameterComparator;
+        Flight**            flights;			// hash table of the in flight events, with 'numberOfQueueSlots' buckets
+        mutex               flightsGuard;
+        unsigned long long  nCollapsedEvents;
+
+        // answers memo -- see 'setAnswerCache(...)'
+        typedef EventDelegate<bool (const _ArgumentType&, _AnswerType*, unsigned long long&)>       AnswerCacheLookup;	// also tells the invalidation generation
+        typedef EventDelegate<bool (const _ArgumentType&, const _AnswerType&, unsigned long long)> AnswerCacheStore;	// stores unless invalidated since the lookup
+        AnswerCacheLookup answerCacheLookup;
+        AnswerCacheStore  answerCacheStore;
+
+        // per key ordered dispatching -- see 'setKeyOrderedDispatching(...)'
+        typedef EventDelegate<size_t (const _ArgumentType&)> KeyExtractor;
+        struct alignas(64) Lane {
+            mutex guard;
+            bool  isBusy;					// an event of this lane is being dispatched
+            int   firstDeferredEvent;		// FIFO of the events dequeued while the lane was busy -- or -1
+            int   lastDeferredEvent;
+        };
+        struct LaneSlot {					// the lane state of each queue slot
+            unsigned int lane;
+            bool         isDeferred;		// if set, the event is on its lane's FIFO
+            int          nextDeferredEvent;	// next event on the same lane's FIFO -- or -1
+        };
+        KeyExtractor laneKeyExtractor;
+        Lane*        lanes;
+        LaneSlot*    laneSlots;				// 'numberOfQueueSlots' entries
+        unsigned int nLanes;
+
+        // multicast -- see 'addMulticastCursor()'
+        constexpr static unsigned long long closedSequenceBit = 1ull << 63;
+        alignas(64) atomic<unsigned long long> publishedSequence;	// number of events ever made dequeueable ('closedSequenceBit' is set on 'close()')
+        unsigned int nMulticastCursors;
+        atomic<unsigned int>* pendingReleases;	// the dispatcher, each multicast cursor & the lane holder (of deferred events) must release the slot
+
+        // conflation -- see 'setConflation(...)'
+        struct ConflationSlot {				// the conflation state of each queue slot
+            size_t conflationKey;
+            int    nextConflatedEvent;			// next pending event on the same 'conflationBuckets' chain -- or -1
+            bool   isConflatable;				// if set, the event is on the 'conflationBuckets' chain
+        };
+        KeyExtractor       conflationKeyExtractor;
+        int*               conflationBuckets;		// 'numberOfQueueSlots' chains of the not yet dequeued conflatable events, by key -- guarded by 'queueGuard'
+        ConflationSlot*    conflationSlots;
+        unsigned long long nConflatedEvents;
+
+        // token bucket admission control -- see 'setAdmissionControl(...)'
+        alignas(64) atomic<unsigned long long> admissionTheoreticalArrivalNS;	// when the bucket will be full again, if no more events are admitted
+        unsigned long long         admissionIntervalNS;		// time for one token to be added to the bucket -- 0: admission control is disabled
+        unsigned long long         admissionCapacityNS;		// burst * 'admissionIntervalNS'
+        AdmissionPolicy            admissionPolicy;
+        Listener                   divertedEventsListener;
+        bool*                      divertedSlots;		// set for the reserved events to be diverted on reporting -- nullptr unless the policy is 'DIVERT'
+        atomic<unsigned long long> nRejectedEvents;
 
         // queue
         alignas(64) QueueElement  events[numberOfQueueSlots];	// here are the elements of the queue
@@ -75,27 +232,55 @@ namespace mutua::events {
         mutex  queueGuard;
         bool   isEmpty;
         bool   isFull;
+        bool   isClosed;	// when set, no new events are accepted and no thread will ever block on 'dequeueGuard' nor 'reservationGuard' again -- see 'close()'
 
         // debug info
         string eventName;
 
 
         QueueEventLink(string eventName)
-                : eventName                            (eventName)
-        		, answerlessConsumerProcedureReference (nullptr)
-                , answerlessConsumerThese              (nullptr)
-				, nAnswerlessConsumerThese             (0)
-        		, answerfullConsumerProcedureReference (nullptr)
-                , answerfullConsumerThese              (nullptr)
-				, nAnswerfullConsumerThese             (0)
-                , listenerProcedureReferences          {}
-                , listenersThis                        {}
-                , nListenerProcedureReferences         (0)
-                , isFull                               (false)
-                , queueHead                            (0)
-                , queueTail                            (0)
-                , queueReservedHead                    (0)
-                , queueReservedTail                    (0) {
+                : answerlessConsumers  (nullptr)
+                , nAnswerlessConsumers (0)
+                , answerfullConsumers  (nullptr)
+                , nAnswerfullConsumers (0)
+                , returningConsumers   (nullptr)
+                , nReturningConsumers  (0)
+                , streamingConsumers   (nullptr)
+                , nStreamingConsumers  (0)
+                , listeners            {}
+                , nListeners           (0)
+                , continuations        (nullptr)
+                , answerHandlers       (nullptr)
+                , handlerAnswers       (nullptr)
+                , consumerInstanceGuards  (nullptr)
+                , nConsumerInstanceGuards (0)
+                , eventsTimeToLiveNS   (0)
+                , deadlines            (nullptr)
+                , nExpiredEvents       (0)
+                , flights              (nullptr)
+                , nCollapsedEvents     (0)
+                , lanes                (nullptr)
+                , laneSlots            (nullptr)
+                , nLanes               (0)
+                , publishedSequence    (0)
+                , nMulticastCursors    (0)
+                , pendingReleases      (nullptr)
+                , conflationBuckets    (nullptr)
+                , conflationSlots      (nullptr)
+                , nConflatedEvents     (0)
+                , admissionTheoreticalArrivalNS (0)
+                , admissionIntervalNS  (0)
+                , admissionCapacityNS  (0)
+                , admissionPolicy      (AdmissionPolicy::REJECT)
+                , divertedSlots        (nullptr)
+                , nRejectedEvents      (0)
+                , queueHead            (0)
+                , queueTail            (0)
+                , queueReservedHead    (0)
+                , queueReservedTail    (0)
+                , isFull               (false)
+                , isClosed             (false)
+                , eventName            (eventName) {
 
             // queue starts empty & locked for dequeueing
 			dequeueGuard.lock();
@@ -117,43 +302,137 @@ namespace mutua::events {
         /** Destructing a 'QueueEventLink' is only safe when the queues are empty and no threads are waiting to enqueue or dequeue an event */
         ~QueueEventLink() {
         	unsetConsumer();
+        	unsetInlineDispatcher();
+        	delete[] flights;
+        	delete[] lanes;
+        	delete[] laneSlots;
+        	delete[] conflationBuckets;
+        	delete[] conflationSlots;
+        	delete[] deadlines;
+        	delete[] pendingReleases;
+        	delete[] divertedSlots;
+        	delete[] continuations;
+        	delete[] answerHandlers;
+        	delete[] handlerAnswers;
 
         	// assure all mutexes are unlocked -- if the statement above is true, this is not needed
         	//for ()
         }
 
+        /** Sets the answerless consumer to be 'consumerProcedureReference' acting on each one of the 'thisInstances' -- the consumer instance pool */
         template <typename _Class> void setAnswerlessConsumer(void (_Class::*consumerProcedureReference) (const _ArgumentType&), vector<_Class*> thisInstances) {
-            union {
-                void (*genericFuncPtr) (void*, const _ArgumentType&);
-                void (_Class::*specificFuncPtr) (const _ArgumentType&);
-            };
-            // set the generic function pointer from the specific one
-            specificFuncPtr                      = consumerProcedureReference;
-            answerlessConsumerProcedureReference = genericFuncPtr;
-            nAnswerlessConsumerThese             = thisInstances.size();
-            // allocate ...
-            answerlessConsumerThese              = new void*[nAnswerlessConsumerThese];
-            // ... and fill the array
-            for (int i=0; i<thisInstances.size(); i++) {
-            	answerlessConsumerThese[i] = thisInstances[i];
+            vector<AnswerlessConsumer> consumers;
+            for (_Class* thisInstance : thisInstances) {
+                consumers.emplace_back(consumerProcedureReference, thisInstance);
             }
+            setAnswerlessConsumer(consumers);
         }
 
+        /** Sets the answerless consumer pool to be the given delegates -- lambdas, functors, functions or methods -- one for each dispatcher thread */
+        void setAnswerlessConsumer(vector<AnswerlessConsumer> consumers) {
+            if (answerlessConsumers != nullptr) {
+                delete[] answerlessConsumers;
+            }
+            nAnswerlessConsumers = consumers.size();
+            answerlessConsumers  = new AnswerlessConsumer[nAnswerlessConsumers];
+            for (unsigned int i=0; i<nAnswerlessConsumers; i++) {
+                answerlessConsumers[i] = consumers[i];
+            }
+        }
+
+        /** Sets the answerfull consumer to be 'consumerProcedureReference' acting on each one of the 'thisInstances' -- the consumer instance pool */
         template <typename _Class> void setAnswerfullConsumer(void (_Class::*consumerProcedureReference) (const _ArgumentType&, _AnswerType*, std::mutex&), vector<_Class*> thisInstances) {
-            union {
-                void (*genericFuncPtr) (void*, const _ArgumentType&, _AnswerType*, std::mutex&);
-                void (_Class::*specificFuncPtr) (const _ArgumentType&, _AnswerType*, std::mutex&);
-            };
-            // set the generic function pointer from the specific one
-            specificFuncPtr                      = consumerProcedureReference;
-            answerfullConsumerProcedureReference = genericFuncPtr;
-            nAnswerfullConsumerThese             = thisInstances.size();
-            // allocate ...
-            answerfullConsumerThese              = new void*[nAnswerfullConsumerThese];
-            // ... and fill the array
-            for (int i=0; i<thisInstances.size(); i++) {
-            	answerfullConsumerThese[i] = thisInstances[i];
+            vector<AnswerfullConsumer> consumers;
+            for (_Class* thisInstance : thisInstances) {
+                consumers.emplace_back(consumerProcedureReference, thisInstance);
             }
+            setAnswerfullConsumer(consumers);
+        }
+
+        /** Sets the answerfull consumer pool to be the given delegates -- lambdas, functors, functions or methods -- one for each dispatcher thread */
+        void setAnswerfullConsumer(vector<AnswerfullConsumer> consumers) {
+            if (answerfullConsumers != nullptr) {
+                delete[] answerfullConsumers;
+            }
+            if (returningConsumers != nullptr) {
+                // the previous answerfull consumers were adapters to these
+                delete[] returningConsumers;
+                returningConsumers  = nullptr;
+                nReturningConsumers = 0;
+            }
+            if (streamingConsumers != nullptr) {
+                // same as above
+                delete[] streamingConsumers;
+                streamingConsumers  = nullptr;
+                nStreamingConsumers = 0;
+            }
+            nAnswerfullConsumers = consumers.size();
+            answerfullConsumers  = new AnswerfullConsumer[nAnswerfullConsumers];
+            for (unsigned int i=0; i<nAnswerfullConsumers; i++) {
+                answerfullConsumers[i] = consumers[i];
+            }
+        }
+
+        /** Sets the answerfull consumer to be 'consumerProcedureReference' -- which returns the answer -- acting on each one of the 'thisInstances' */
+        template <typename _Class> void setReturningConsumer(_AnswerType (_Class::*consumerProcedureReference) (const _ArgumentType&), vector<_Class*> thisInstances) {
+            vector<ReturningConsumer> consumers;
+            for (_Class* thisInstance : thisInstances) {
+                consumers.emplace_back(consumerProcedureReference, thisInstance);
+            }
+            setReturningConsumer(consumers);
+        }
+
+        /** Sets the answerfull consumer pool to be the given delegates, which simply return the answer: storing it & signaling its
+         *  readiness is up to the framework -- so no consumer can forget to unlock the answer mutex. Dispatchers consume such events
+         *  in batches, locking the queue once per batch (see 'QueueEventDispatcher::dispatchReturningEventsLoop(...)').
+         *  'answerfullConsumers' are set to adapters, so any code calling answerfull consumers keeps working */
+        void setReturningConsumer(vector<ReturningConsumer> consumers) {
+            static_assert(std::is_move_assignable<_AnswerType>::value, "QueueEventLink: returning consumers require a move assignable '_AnswerType' -- the returned answer is assigned to the producer's answer object");
+            unsigned int       nConsumers = consumers.size();
+            ReturningConsumer* pool       = new ReturningConsumer[nConsumers];
+            vector<AnswerfullConsumer> adapters;
+            for (unsigned int i=0; i<nConsumers; i++) {
+                pool[i] = consumers[i];
+                adapters.emplace_back([consumer = &pool[i]](const _ArgumentType& eventParameter, _AnswerType* answerObjectReference, std::mutex& answerMutex) {
+                    if (answerObjectReference == nullptr) {
+                        // reserved as answerless
+                        (*consumer)(eventParameter);
+                        return;
+                    }
+                    *answerObjectReference = (*consumer)(eventParameter);
+                    answerMutex.unlock();
+                });
+            }
+            setAnswerfullConsumer(adapters);
+            returningConsumers  = pool;
+            nReturningConsumers = nConsumers;
+        }
+
+        /** Sets the answerfull consumer pool for links whose '_AnswerType' is an 'AnswerStream': each delegate pushes the answer chunks into the
+         *  given stream as they are produced, while the event producer pops them as they arrive -- so it doesn't have to wait for the whole answer.
+         *  The framework closes the stream (and signals the answer mutex) when the consumer returns, or fails it with the exception it throws.
+         *  Producers reserve such events with 'reserveEventForReporting(eventParameterPointer, &answerStream)' and then 'pop(...)' the chunks. */
+        void setStreamingConsumer(vector<StreamingConsumer> consumers) {
+            unsigned int       nConsumers = consumers.size();
+            StreamingConsumer* pool       = new StreamingConsumer[nConsumers];
+            vector<AnswerfullConsumer> adapters;
+            for (unsigned int i=0; i<nConsumers; i++) {
+                pool[i] = consumers[i];
+                adapters.emplace_back([consumer = &pool[i]](const _ArgumentType& eventParameter, _AnswerType* answerStream, std::mutex& answerMutex) {
+                    try {
+                        (*consumer)(eventParameter, *answerStream);
+                    } catch (...) {
+                        // the dispatcher will signal the answer mutex
+                        answerStream->fail(std::current_exception());
+                        throw;
+                    }
+                    answerStream->close();
+                    answerMutex.unlock();
+                });
+            }
+            setAnswerfullConsumer(adapters);
+            streamingConsumers  = pool;
+            nStreamingConsumers = nConsumers;
         }
 
         // dummy consumers to help when destructing the object -- any false wakeup should invoke these, not the real ones
@@ -161,59 +440,97 @@ namespace mutua::events {
         void dummyAnswerfullConsumer(const _ArgumentType& arg, _AnswerType* ans, std::mutex& m) {m.unlock();}
 
         void unsetConsumer() {
-        	answerlessConsumerProcedureReference = nullptr;
-        	if (answerlessConsumerThese != nullptr) {
-        		delete[] answerlessConsumerThese;
-        		answerlessConsumerThese  = nullptr;
-        	}
-            nAnswerlessConsumerThese = 0;
-            answerfullConsumerProcedureReference = nullptr;
-            if (answerfullConsumerThese != nullptr) {
-            	delete[] answerfullConsumerThese;
-            	answerfullConsumerThese  = nullptr;
+            if (answerlessConsumers != nullptr) {
+                delete[] answerlessConsumers;
+                answerlessConsumers = nullptr;
+            }
+            nAnswerlessConsumers = 0;
+            if (answerfullConsumers != nullptr) {
+                delete[] answerfullConsumers;
+                answerfullConsumers = nullptr;
+            }
+            nAnswerfullConsumers = 0;
+            if (returningConsumers != nullptr) {
+                delete[] returningConsumers;
+                returningConsumers = nullptr;
             }
-            nAnswerfullConsumerThese = 0;
+            nReturningConsumers = 0;
+            if (streamingConsumers != nullptr) {
+                delete[] streamingConsumers;
+                streamingConsumers = nullptr;
+            }
+            nStreamingConsumers = 0;
         }
 
         /** Adds a listener to operate on a single instance, regardless of the number of dispatcher threads */
         template <typename _Class> void addListener(void (_Class::*listenerProcedureReference) (const _ArgumentType&), _Class* listenerThis) {
-            union {
-                void (*genericFuncPtr) (void*, const _ArgumentType&);
-                void (_Class::*specificFuncPtr) (const _ArgumentType&);
-            };
-            if (nListenerProcedureReferences >= _NListeners) {
+            addListener(Listener(listenerProcedureReference, listenerThis));
+        }
+
+        /** Adds a listener delegate -- a lambda, functor, function or method -- called by any of the dispatcher threads (so it must be thread safe) */
+        void addListener(const Listener& listener) {
+            if (nListeners >= _NListeners) {
                 THROW_EXCEPTION(overflow_error, "Out of listener slots (max="+to_string(_NListeners)+") while attempting to add a new event listener to '" + eventName + "' " +
                                                 "(you may wish to increase '_NListeners' at '" + eventName + "'s declaration)");
             }
-            // set the generic function pointer from the specific one
-            specificFuncPtr                                           = listenerProcedureReference;
-            listenerProcedureReferences[nListenerProcedureReferences] = genericFuncPtr;
-                          listenersThis[nListenerProcedureReferences] = listenerThis;
-            nListenerProcedureReferences++;
+            listeners[nListeners] = listener;
+            nListeners++;
         }
 
-        unsigned int findListener(void(&&listenerProcedureReference)(void*, const _ArgumentType&)) {
-            for (unsigned int i=0; i<nListenerProcedureReferences; i++) {
-                if (listenerProcedureReferences[i] == listenerProcedureReference) {
+        unsigned int findListener(const Listener& listener) {
+            for (unsigned int i=0; i<nListeners; i++) {
+                if (listeners[i] == listener) {
                     return i;
                 }
             }
             return -1;
         }
 
-        bool removeListener(void (&&listenerProcedureReference) (void*, const _ArgumentType&)) {
-            unsigned int pos = findListener(listenerProcedureReference);
+        template <typename _Class> bool removeListener(void (_Class::*listenerProcedureReference) (const _ArgumentType&), _Class* listenerThis) {
+            return removeListener(Listener(listenerProcedureReference, listenerThis));
+        }
+
+        bool removeListener(const Listener& listener) {
+            unsigned int pos = findListener(listener);
             if (pos == -1) {
                 return false;
             }
-            memcpy(&(listenerProcedureReferences[pos]), &(listenerProcedureReferences[pos+1]), (nListenerProcedureReferences - (pos+1)) * sizeof(listenerProcedureReferences[0]));
-            memcpy(              &(listenersThis[pos]),               &(listenersThis[pos+1]), (nListenerProcedureReferences - (pos+1)) * sizeof(listenersThis[0]));
-            nListenerProcedureReferences--;
-            listenerProcedureReferences[nListenerProcedureReferences] = nullptr;
-                          listenersThis[nListenerProcedureReferences] = nullptr;
+            for (unsigned int i=pos; i<nListeners-1; i++) {
+                listeners[i] = listeners[i+1];
+            }
+            nListeners--;
+            listeners[nListeners] = nullptr;
             return true;
         }
 
+        /** Enables the inline-when-idle hybrid execution: when an event is reported on an empty queue and one of the 'nConsumerInstances'
+         *  consumer instances is free, 'reportReservedEvent(...)' dispatches it right away, on the producer thread, through 'dispatcher' --
+         *  sparing the cross-thread wake up of a dispatcher thread (as 'DirectEventLink' does on the tests). Under load, events are queued as usual.
+         *  Consumer instance exclusivity is kept through 'consumerInstanceGuards', which dispatcher threads must also hold while dispatching.
+         *  Meant to be called by the dispatcher ('QueueEventDispatcher::enableInlineWhenIdle()') before any events are reported. */
+        void setInlineDispatcher(const InlineDispatcher& dispatcher, unsigned int nConsumerInstances) {
+        	scoped_lock<mutex> lock(queueGuard);
+        	delete[] consumerInstanceGuards;
+        	inlineDispatcher        = dispatcher;
+        	nConsumerInstanceGuards = nConsumerInstances;
+        	consumerInstanceGuards  = nConsumerInstances > 0 ? new mutex[nConsumerInstances] : nullptr;
+        }
+
+        /** Disables the inline-when-idle hybrid execution -- to be called when no dispatcher threads are running. Waits for any inline
+         *  dispatching still taking place on producer threads */
+        void unsetInlineDispatcher() {
+        	scoped_lock<mutex> lock(queueGuard);
+        	for (unsigned int i=0; i<nConsumerInstanceGuards; i++) {
+        		// inline dispatchers let go of their consumer instances before taking 'queueGuard' again
+        		consumerInstanceGuards[i].lock();
+        		consumerInstanceGuards[i].unlock();
+        	}
+        	inlineDispatcher = nullptr;
+        	delete[] consumerInstanceGuards;
+        	consumerInstanceGuards  = nullptr;
+        	nConsumerInstanceGuards = 0;
+        }
+
         /** Queue length, differently than the queue size, is the number of elements currently waiting to be dequeued */
         int getQueueLength() {
         	scoped_lock<mutex> lock(queueGuard);
@@ -276,9 +593,15 @@ namespace mutua::events {
          *  NOTE: the heading of this code should be the same as in the overloaded method. */
         inline int reserveEventForReporting(_ArgumentType*& eventParameterPointer) {
 
+        	bool isAdmitted = likely(admissionIntervalNS == 0) || admitEvent();
+
         FULL_QUEUE_RETRY:
 
 			queueGuard.lock();
+			if (unlikely(isClosed)) {
+				queueGuard.unlock();
+				throwClosedLinkException();
+			}
 			int eventId = unguardedReserveEventForReporting(eventParameterPointer);
 
 			if (unlikely(eventId == -1)) {
@@ -297,14 +620,30 @@ namespace mutua::events {
             }
 
             // prepare the event slot and return the event id
-            QueueElement& futureEvent = events[eventId];
-            futureEvent.reserved      = true;
-            eventParameterPointer     = &futureEvent.eventParameter;
+            QueueElement& futureEvent         = events[eventId];
+            futureEvent.answerObjectReference = nullptr;	// answerless
+            futureEvent.dispatchState.store(EventDispatchState::QUEUED, memory_order_relaxed);
+            futureEvent.reserved              = true;
+            eventParameterPointer             = &futureEvent.eventParameter;
+            prepareOptionalFeatures(eventId, isAdmitted);
 			queueGuard.unlock();
 			return eventId;
 
         }
 
+        /** To be called, with 'queueGuard' locked, as 'eventId' gets reserved: resets its state on the side arrays of the enabled features */
+        inline void prepareOptionalFeatures(int eventId, bool isAdmitted) {
+        	if (unlikely(pendingReleases != nullptr)) {
+        		pendingReleases[eventId].store(1 + nMulticastCursors, memory_order_relaxed);
+        	}
+        	if (unlikely(deadlines != nullptr)) {
+        		deadlines[eventId] = eventsTimeToLiveNS != 0 ? getMonotonicTimeNS() + eventsTimeToLiveNS : 0;
+        	}
+        	if (unlikely(divertedSlots != nullptr)) {
+        		divertedSlots[eventId] = !isAdmitted;
+        	}
+        }
+
         /** Reserves an 'eventId' (and returns it) for further enqueueing.
          *  Points 'eventParameterPointer' to a location able to be filled with the event information.
          *  'answerObjectReference' is a pointer where the 'answerfull' consumer should store the answer -- give a nullptr if the consumer is 'answerless'.
@@ -312,9 +651,15 @@ namespace mutua::events {
          *  NOTE: the heading of this code should be the same as in the overloaded method. */
         inline int reserveEventForReporting(_ArgumentType*& eventParameterPointer, _AnswerType* answerObjectReference) {
 
+        	bool isAdmitted = likely(admissionIntervalNS == 0) || admitEvent();
+
 		FULL_QUEUE_RETRY:
 
 			queueGuard.lock();
+			if (unlikely(isClosed)) {
+				queueGuard.unlock();
+				throwClosedLinkException();
+			}
 			int eventId = unguardedReserveEventForReporting(eventParameterPointer);
 
 			if (unlikely(eventId == -1)) {
@@ -336,34 +681,218 @@ namespace mutua::events {
             QueueElement& futureEvent         = events[eventId];
             futureEvent.answerObjectReference = answerObjectReference;
             futureEvent.exception             = nullptr;
+            futureEvent.completionState.store(PENDING, memory_order_relaxed);
+            futureEvent.dispatchState.store(EventDispatchState::QUEUED, memory_order_relaxed);
             futureEvent.reserved              = true;
             eventParameterPointer             = &futureEvent.eventParameter;
+            prepareOptionalFeatures(eventId, isAdmitted);
 			futureEvent.answerMutex.try_lock();		// prepare to wait for the answer
+			if (unlikely((bool)answerHandler)) {
+				registerAnswerHandler(futureEvent, answerHandler);
+			} else if (unlikely(futureEvent.hasAnswerHandler)) {
+				unregisterAnswerHandler(futureEvent);
+			}
 			queueGuard.unlock();
             return eventId;
         }
 
+        /** Reserves an answerfull 'eventId' (and returns it) whose answer will be delivered to 'answerHandler' -- a continuation called as soon
+         *  as the answerfull consumer returns, on the dispatcher thread (see 'answersTo(...)' to have it called by another link's dispatcher).
+         *  The producer never needs to wait for the answer, which is stored on '*answerObjectReference' -- that must remain valid until then.
+         *  Events reserved this way may not be awaited with 'answer(...)'. */
+        inline int reserveEventForReporting(_ArgumentType*& eventParameterPointer, _AnswerType* answerObjectReference, const AnswerHandler& answerHandler) {
+        	int eventId = reserveEventForReporting(eventParameterPointer, answerObjectReference);
+        	registerAnswerHandler(events[eventId], answerHandler);
+        	return eventId;
+        }
+
+        /** Same as above, but with the answer stored by the link, on the 'handlerAnswers' entry of the slot -- so it is valid only during
+         *  the 'answerHandler' call. '_AnswerType' must be default constructible to use this method */
+        inline int reserveEventForReporting(_ArgumentType*& eventParameterPointer, const AnswerHandler& answerHandler) {
+        	call_once(handlerAnswersAllocation, [this] { handlerAnswers = new _AnswerType[numberOfQueueSlots]; });
+        	int eventId = reserveEventForReporting(eventParameterPointer, (_AnswerType*)nullptr);
+        	events[eventId].answerObjectReference = &handlerAnswers[eventId];
+        	registerAnswerHandler(events[eventId], answerHandler);
+        	return eventId;
+        }
+
+        /** Sets (or, if 'handler' is nullptr, unsets) the answer continuation for all answerfull events reserved from now on,
+         *  unless they are reserved with their own handler -- as described on 'reserveEventForReporting(..., const AnswerHandler&)' */
+        void setAnswerHandler(const AnswerHandler& handler) {
+        	scoped_lock<mutex> lock(queueGuard);
+        	answerHandler = handler;
+        }
+
+        /** Returns an 'AnswerHandler' that reports each answer as an event on 'completionLink' -- whose argument must be assignable
+         *  from '_AnswerType' -- so the next step is taken by that link's dispatcher. Answers that failed aren't forwarded
+         *  (the exception was already dumped by the dispatcher). Beware of cycles: reporting blocks if 'completionLink' is full. */
+        template <class _CompletionLink>
+        static AnswerHandler answersTo(_CompletionLink& completionLink) {
+        	return [&completionLink](const _ArgumentType&, _AnswerType* answer, const exception_ptr&) {
+        		if (answer == nullptr) {
+        			return;
+        		}
+        		decltype(completionLink.events[0].eventParameter)* completionParameterPointer;
+        		int completionEventId = completionLink.reserveEventForReporting(completionParameterPointer);
+        		*completionParameterPointer = *answer;
+        		completionLink.reportReservedEvent(completionEventId);
+        	};
+        }
+
+        inline void registerAnswerHandler(QueueElement& event, const AnswerHandler& handler) {
+        	int eventId = &event - events;
+        	allocateContinuations();
+        	call_once(answerHandlersAllocation, [this] { answerHandlers = new AnswerHandler[numberOfQueueSlots]; });
+        	answerHandlers[eventId] = handler;
+        	continuations[eventId]  = [this, eventId]() { handleAnswer(eventId); };
+        	event.hasAnswerHandler  = true;
+        	event.completionState.store(CONTINUATION_SET, memory_order_relaxed);
+        }
+
+        /** Undoes 'registerAnswerHandler(...)' -- for reserved events not reported yet */
+        inline void unregisterAnswerHandler(QueueElement& event) {
+        	if (event.hasAnswerHandler) {
+        		answerHandlers[&event - events] = nullptr;
+        		event.hasAnswerHandler = false;
+        		event.completionState.store(PENDING, memory_order_relaxed);
+        	}
+        }
+
+        /** The continuation of events having an answer handler */
+        void handleAnswer(int eventId) {
+        	QueueElement& event = events[eventId];
+        	try {
+        		bool isCancelled = isCancelledEvent(event);
+        		answerHandlers[eventId](event.eventParameter, isCancelled ? nullptr : event.answerObjectReference, event.exception);
+        	} catch (const std::exception& e) {
+        		DUMP_EXCEPTION(runtime_error("Exception in answer handler: "s + e.what()),
+        		               "QueueEventLink: exception in answer handler. Caused by: "s + e.what());
+        	} catch (...) {
+        		DUMP_EXCEPTION(runtime_error("Unknown exception in answer handler"),
+        		               "QueueEventLink: exception in answer handler. Caused by: <<unknown cause>>");
+        	}
+        }
+
+        /** A slot's continuation is only written by whoever claims its completion state (see 'trySetContinuation(...)') and read by the
+         *  completer after that -- so 'continuations' may be allocated on first use, by any thread */
+        inline void allocateContinuations() {
+        	call_once(continuationsAllocation, [this] { continuations = new Continuation[numberOfQueueSlots]; });
+        }
+
         /** Signals that the slot at 'eventId' is available for consumption / notification.
          *  This method takes constant time -- a little bit longer if the queue is empty. */
         inline void reportReservedEvent(int eventId) {
+        	reportReservedEvent(eventId, false);
+        }
+
+        /** Same as above, for 'reportConflatedEvent(...)': if 'isConflatable', the event is indexed for conflation as it gets published --
+         *  so updates never touch a parameter still being read by this method -- unless it is dispatched inline, rejected by the admission
+         *  control or read by multicast cursors (which may be reading any published slot) */
+        inline void reportReservedEvent(int eventId, bool isConflatable) {
+        	if (unlikely(divertedSlots != nullptr) && divertedSlots[eventId]) {
+        		divertEvent(eventId);
+        	}
+        	if (unlikely(lanes != nullptr)) {
+        		laneSlots[eventId].lane = laneKeyExtractor(events[eventId].eventParameter) % nLanes;
+        	}
             // signal that the slot at 'eventId' is available for dequeueing
         	queueGuard.lock();
+        	if (unlikely((bool)inlineDispatcher) && isEmpty && (eventId == queueTail) && (!isClosed) &&
+        	    ( events[(eventId+1) & queueSlotsModulus].reserved || ((int) ((eventId+1) & queueSlotsModulus) == queueReservedTail) ) ) {
+        		// 'eventId' would be the only dequeueable event: dispatch it inline, if a consumer instance is free
+        		int consumerInstance = tryLockConsumerInstance();
+        		if (consumerInstance != -1) {
+        			// enqueue & dequeue it at once -- as 'reserveEventForDispatching(...)' would, it remains reserved until released
+        			queueTail = queueHead = (eventId+1) & queueSlotsModulus;
+        			enterLane(eventId);
+        			unindexConflatableEvent(eventId);
+        			publishSequence(1);
+        			queueGuard.unlock();
+        			inlineDispatcher(&events[eventId], consumerInstance);
+        			if (nConsumerInstanceGuards > 0) {
+        				consumerInstanceGuards[consumerInstance].unlock();
+        			}
+        			releaseEvent(eventId);
+        			return;
+        		}
+        	}
         	events[eventId].reserved = false;
+        	if (unlikely(isConflatable) && (nMulticastCursors == 0) &&
+        	    (events[eventId].dispatchState.load(memory_order_relaxed) == EventDispatchState::QUEUED)) {
+        		indexConflatableEvent(eventId);
+        	}
             if (likely(eventId == queueTail)) {
+            	unsigned int nPublishedEvents = 0;
             	do {
             		queueTail = (queueTail+1) & queueSlotsModulus;
+            		nPublishedEvents++;
             	} while (unlikely( (!events[queueTail].reserved) && (queueTail != queueReservedTail) ));
+            	publishSequence(nPublishedEvents);
                 if (likely(isEmpty)) {
                 	isEmpty = false;
-                	dequeueGuard.unlock();	// 'emptyGuard' only points to 'dequeueGuard'
+                	if (likely(!isClosed)) {
+                		dequeueGuard.unlock();	// 'emptyGuard' only points to 'dequeueGuard'
+                	}
                 }
             }
 			queueGuard.unlock();
         }
 
+        /** To be called, with 'queueGuard' locked, as events become dequeueable */
+        inline void publishSequence(unsigned int nPublishedEvents) {
+        	publishedSequence.store(publishedSequence.load(memory_order_relaxed) + nPublishedEvents, memory_order_release);
+        	if (unlikely(nMulticastCursors > 0)) {
+        		publishedSequence.notify_all();
+        	}
+        }
+
+        /** Multicast: registers an independent reader of the reported events, returning its starting sequence -- the slot of sequence 's'
+         *  is 's & queueSlotsModulus' and it may be read as soon as 'publishedSequence' goes beyond 's'. Each cursor must 'releaseEvent(...)'
+         *  the slots it has read, which are only reclaimed when the dispatcher and all cursors released them -- so slow cursors hold the
+         *  producers back, but no events are ever copied. See 'MulticastDispatcher'. To be called while no events are in flight */
+        unsigned long long addMulticastCursor() {
+        	scoped_lock<mutex> lock(queueGuard);
+        	if ( (queueReservedHead != queueReservedTail) || isFull ) {
+        		THROW_EXCEPTION(runtime_error, "Attempting to add a multicast cursor to '" + eventName + "' while it has events in flight");
+        	}
+        	allocatePendingReleases();
+        	nMulticastCursors++;
+        	return publishedSequence.load(memory_order_relaxed) & ~closedSequenceBit;
+        }
+
+        /** Enables the release counting of 'releaseEvent(...)' -- to be called, with 'queueGuard' locked, while no events are in flight */
+        void allocatePendingReleases() {
+        	if (pendingReleases == nullptr) {
+        		pendingReleases = new atomic<unsigned int>[numberOfQueueSlots];
+        		for (unsigned int i=0; i<numberOfQueueSlots; i++) {
+        			pendingReleases[i].store(1, memory_order_relaxed);
+        		}
+        	}
+        }
+
+        /** Unregisters a multicast cursor -- to be called after it read all events, when no events are in flight */
+        void removeMulticastCursor() {
+        	scoped_lock<mutex> lock(queueGuard);
+        	nMulticastCursors--;
+        }
+
+        /** Returns the index of a consumer instance not being used by anyone (which is then locked) or -1 if all of them are busy */
+        inline int tryLockConsumerInstance() {
+        	if (nConsumerInstanceGuards == 0) {
+        		// listeners only: they are required to be thread safe
+        		return 0;
+        	}
+        	for (unsigned int i=0; i<nConsumerInstanceGuards; i++) {
+        		if (consumerInstanceGuards[i].try_lock()) {
+        			return i;
+        		}
+        	}
+        	return -1;
+        }
+
         /** Starts the zero-copy dequeueing process.
          *  Points 'dequeuedElementPointer' to the queue location containing the event ready to be consumed & notified, returning the 'eventId'.
-         *  This method takes constant time but blocks if the queue is empty. */
+         *  This method takes constant time but blocks if the queue is empty -- or returns -1 if the queue is empty and the link was closed. */
         inline int reserveEventForDispatching(QueueElement*& dequeuedElementPointer) {
 
          EMPTY_QUEUE_RETRY:
@@ -372,6 +901,11 @@ namespace mutua::events {
 
 			// is queue empty?
             if (unlikely( isEmpty && (queueHead == queueTail) )) {
+            	if (unlikely(isClosed)) {
+            		// drained: no more events will ever come
+            		queueGuard.unlock();
+            		return -1;
+            	}
             	// Queue was already empty before the call to this method. Wait on the mutex
             	queueGuard.unlock();
             	dequeueGuard.lock();	// 2nd lock. Any caller will wait here. Unlocked only by 'reportReservedEvent(...)'
@@ -379,25 +913,155 @@ namespace mutua::events {
             	goto EMPTY_QUEUE_RETRY;
             }
 
+            int eventId = unguardedReserveEventForDispatching(dequeuedElementPointer);
+
+            queueGuard.unlock();
+
+            return eventId;
+        }
+
+        /** Same as above, but never blocks: returns -1 if the queue is empty */
+        inline int tryReserveEventForDispatching(QueueElement*& dequeuedElementPointer) {
+        	scoped_lock<mutex> lock(queueGuard);
+        	if (isEmpty && (queueHead == queueTail)) {
+        		return -1;
+        	}
+        	return unguardedReserveEventForDispatching(dequeuedElementPointer);
+        }
+
+        /** Blocks until an event may be dequeued, without dequeueing it -- returning false if the queue is empty and the link was closed.
+         *  Meant for dispatchers that must acquire something else before dequeueing: they follow with 'tryReserveEventForDispatching(...)',
+         *  which fails if another thread dequeued the event meanwhile */
+        inline bool waitForDequeueableEvent() {
+        	while (true) {
+        		queueGuard.lock();
+        		if (likely( (!isEmpty) || (queueHead != queueTail) )) {
+        			queueGuard.unlock();
+        			return true;
+        		}
+        		if (isClosed) {
+        			queueGuard.unlock();
+        			return false;
+        		}
+        		queueGuard.unlock();
+        		dequeueGuard.lock();	// unlocked by 'reportReservedEvent(...)', as in 'reserveEventForDispatching(...)'
+        		dequeueGuard.unlock();
+        	}
+        }
+
+        /** To be called, with 'queueGuard' locked, when the queue is known not to be empty: dequeues the event at 'queueHead' */
+        inline int unguardedReserveEventForDispatching(QueueElement*& dequeuedElementPointer) {
             int eventId = queueHead;
             queueHead = (queueHead+1) & queueSlotsModulus;
 
             // will dequeueing this element make the queue empty? Set the waiting mutex
             if (queueHead == queueTail) {
-            	dequeueGuard.lock();		// 1st lock. Won't wait yet.
+            	if (likely(!isClosed)) {
+            		dequeueGuard.lock();	// 1st lock. Won't wait yet.
+            	}
             	isEmpty = true;
             }
 
             dequeuedElementPointer = &events[eventId];
             dequeuedElementPointer->reserved = true;
+            enterLane(eventId);
+            unindexConflatableEvent(eventId);
+
+            return eventId;
+        }
+
+        /** Batch version of 'reserveEventForDispatching(...)': dequeues up to 'maxEvents' at once, returning how many were dequeued -- their
+         *  'eventId's are consecutive (modulo the queue size) and start at 'firstEventId'. Blocks if the queue is empty -- or returns 0 if
+         *  the queue is empty and the link was closed. No more than a fair share of the queued events, among 'nDispatchingThreads', is
+         *  dequeued -- but at least one. Dequeued events must be released with 'releaseEvents(...)' */
+        inline unsigned int reserveEventsForDispatching(int& firstEventId, unsigned int maxEvents, unsigned int nDispatchingThreads = 1) {
+
+         EMPTY_QUEUE_RETRY:
+
+			queueGuard.lock();
+
+			// is queue empty?
+            if (unlikely( isEmpty && (queueHead == queueTail) )) {
+            	if (unlikely(isClosed)) {
+            		queueGuard.unlock();
+            		return 0;
+            	}
+            	queueGuard.unlock();
+            	dequeueGuard.lock();	// 2nd lock. Any caller will wait here. Unlocked only by 'reportReservedEvent(...)'
+            	dequeueGuard.unlock();
+            	goto EMPTY_QUEUE_RETRY;
+            }
+
+            unsigned int nEvents = ((queueTail - queueHead - 1) & queueSlotsModulus) + 1;
+            if (nDispatchingThreads > 1) {
+            	nEvents = (nEvents + nDispatchingThreads - 1) / nDispatchingThreads;
+            }
+            if (nEvents > maxEvents) {
+            	nEvents = maxEvents;
+            }
+            firstEventId = queueHead;
+            for (unsigned int i=0; i<nEvents; i++) {
+            	events[(firstEventId+i) & queueSlotsModulus].reserved = true;
+            	enterLane((firstEventId+i) & queueSlotsModulus);
+            	unindexConflatableEvent((firstEventId+i) & queueSlotsModulus);
+            }
+            queueHead = (queueHead+nEvents) & queueSlotsModulus;
+
+            // did dequeueing these elements make the queue empty? Set the waiting mutex
+            if (queueHead == queueTail) {
+            	if (likely(!isClosed)) {
+            		dequeueGuard.lock();	// 1st lock. Won't wait yet.
+            	}
+            	isEmpty = true;
+            }
 
             queueGuard.unlock();
 
-            return eventId;
+            return nEvents;
+        }
+
+        /** Batch version of 'releaseEvent(...)', for the events dequeued by 'reserveEventsForDispatching(...)' -- one lock for all of them */
+        inline void releaseEvents(int firstEventId, unsigned int nEvents) {
+        	if (unlikely( (nMulticastCursors > 0) || (lanes != nullptr) )) {
+        		for (unsigned int i=0; i<nEvents; i++) {
+        			releaseEvent((firstEventId+i) & queueSlotsModulus);
+        		}
+        		return;
+        	}
+        	queueGuard.lock();
+        	for (unsigned int i=0; i<nEvents; i++) {
+        		events[(firstEventId+i) & queueSlotsModulus].reserved = false;
+        	}
+            if (likely( ((queueReservedHead - firstEventId) & queueSlotsModulus) < nEvents )) {
+            	do {
+            		queueReservedHead = (queueReservedHead+1) & queueSlotsModulus;
+            	} while (unlikely( (queueReservedHead != queueHead) && (!events[queueReservedHead].reserved) ));
+                if (unlikely(isFull)) {
+                	isFull = false;
+                	if (likely(!isClosed)) {
+                		reservationGuard.unlock();
+                	}
+                }
+            }
+			queueGuard.unlock();
+        }
+
+        /** Gives back a reserved (but not reported) 'eventId' the reporter ended up not needing: it is reported as cancelled, so
+         *  dispatchers release it without calling consumers nor listeners. Used by 'LinkConnector' for returning unused credits */
+        void discardReservedEvent(int eventId) {
+        	if (unlikely(divertedSlots != nullptr)) {
+        		divertedSlots[eventId] = false;
+        	}
+        	events[eventId].dispatchState.store(EventDispatchState::CANCELLED, memory_order_relaxed);
+        	reportReservedEvent(eventId);
         }
 
         /** Allows 'eventId' reuse (making that slot available for enqueueing a new element) */
         inline void releaseEvent(int eventId) {
+        	if (unlikely(pendingReleases != nullptr) && (pendingReleases[eventId].fetch_sub(1, memory_order_acq_rel) != 1)) {
+        		// not the last release: a multicast cursor, the dispatcher or a lane holder (see 'enterLane(...)') still needs the slot
+        		return;
+        	}
         	queueGuard.lock();
         	events[eventId].reserved = false;
             if (likely(eventId == queueReservedHead)) {
@@ -406,25 +1070,603 @@ namespace mutua::events {
             	} while (unlikely( (queueReservedHead != queueHead) && (!events[queueReservedHead].reserved) ));
                 if (unlikely(isFull)) {
                 	isFull = false;
-                	reservationGuard.unlock();
+                	if (likely(!isClosed)) {
+                		reservationGuard.unlock();
+                	}
                 }
             }
 			queueGuard.unlock();
         }
 
+        /** Drain protocol, 1st step: stops accepting new events -- any further attempt to reserve an event will throw -- and wakes up
+         *  every thread blocked on this link: producers waiting for a free slot (they will then throw) and dispatchers waiting for an
+         *  event (they will be given any remaining events and then -1, meaning the link was drained).
+         *  Events already reserved may still be reported. */
+        void close() {
+        	scoped_lock<mutex> lock(queueGuard);
+        	if (isClosed) {
+        		return;
+        	}
+        	isClosed = true;
+        	publishedSequence.fetch_or(closedSequenceBit, memory_order_release);
+        	publishedSequence.notify_all();
+        	if (isEmpty) {
+        		dequeueGuard.unlock();		// 'reserveEventForDispatching(...)' & 'reportReservedEvent(...)' won't touch it again
+        	}
+        	if (isFull) {
+        		reservationGuard.unlock();	// 'reserveEventForReporting(...)' & 'releaseEvent(...)' won't touch it again
+        	}
+        }
+
+        /** Drain protocol, last step: to be called on a closed link after all dispatcher threads were joined.
+         *  Any answerfull events still on the queue will have their waiters woken up with an exception -- so no producer is left
+         *  blocked on 'waitForAnswer(...)'. Returns the number of leftover events: the ones that were queued but never dispatched
+         *  plus the ones reserved but not (yet) reported. */
+        unsigned int discardLeftoverEvents() {
+        	scoped_lock<mutex> lock(queueGuard);
+        	unsigned int nQueuedEvents = (isEmpty && (queueHead == queueTail)) ? 0 : ((queueTail - queueHead - 1) & queueSlotsModulus) + 1;
+        	for (unsigned int i=0; i<nQueuedEvents; i++) {
+        		QueueElement& event = events[(queueHead+i) & queueSlotsModulus];
+        		if ( (event.answerObjectReference != nullptr) && (!isCancelledEvent(event)) ) {
+        			event.exception             = make_exception_ptr(runtime_error("QueueEventLink '"+eventName+"' was closed before this event could be consumed"));
+        			event.answerObjectReference = nullptr;
+        			event.answerMutex.unlock();
+        			completeAnswerfullEvent(event);
+        		}
+        	}
+        	unsigned int nReservedSlots;
+        	if (queueReservedTail == queueReservedHead) {
+        		nReservedSlots = isFull ? numberOfQueueSlots : 0;
+        	} else {
+        		nReservedSlots = (queueReservedTail - queueReservedHead) & queueSlotsModulus;
+        	}
+        	// dispatched events still held by multicast cursors (which keep reading them) are not leftovers
+        	unsigned int nDispatchedSlots;
+        	if (queueHead == queueReservedHead) {
+        		nDispatchedSlots = (isFull && isEmpty) ? numberOfQueueSlots : 0;
+        	} else {
+        		nDispatchedSlots = (queueHead - queueReservedHead) & queueSlotsModulus;
+        	}
+        	return nReservedSlots - nDispatchedSlots;
+        }
+
+        /** Cancels 'eventId' -- typically because whoever wanted its answer went away:
+         *    - if it was not yet dispatched, dispatchers will skip it (not calling the consumer nor the listeners) and its waiters
+         *      are woken up right away, with an 'EventCancelled' exception -- and true is returned;
+         *    - if it is being consumed, the cancellation token is set: the consumer may poll it with 'isCurrentEventCancelled()'
+         *      and give up (throwing 'EventCancelled', for instance) -- waiters are woken up when the consumer returns.
+         *  Must be called after 'eventId' was reserved and before the answer is collected */
+        bool cancelEvent(int eventId) {
+        	QueueElement& event = events[eventId];
+        	if (cancelQueuedEvent<EventCancelled>(event, "was cancelled before being consumed")) {
+        		return true;
+        	}
+        	EventDispatchState running = EventDispatchState::RUNNING;
+        	event.dispatchState.compare_exchange_strong(running, EventDispatchState::CANCELLATION_REQUESTED, memory_order_acq_rel);
+        	return false;
+        }
+
+        /** Moves a still queued 'event' to 'CANCELLED', failing its waiters with a '_ExceptionType' -- returns false if it was not queued anymore.
+         *  The event stays 'CANCELLING' while its waiters are failed: dispatchers skip it, but only release its slot -- which could then be
+         *  reused by another event -- after it gets 'CANCELLED' (see 'startDispatching(...)') */
+        template <typename _ExceptionType>
+        bool cancelQueuedEvent(QueueElement& event, const char* reason) {
+        	EventDispatchState queued = EventDispatchState::QUEUED;
+        	if (!event.dispatchState.compare_exchange_strong(queued, EventDispatchState::CANCELLING, memory_order_acq_rel)) {
+        		return false;
+        	}
+        	if (event.answerObjectReference != nullptr) {
+        		event.exception = make_exception_ptr(_ExceptionType("Event of '"+eventName+"' "+reason));
+        		event.answerMutex.unlock();
+        		completeAnswerfullEvent(event);
+        	}
+        	event.dispatchState.store(EventDispatchState::CANCELLED, memory_order_release);
+        	return true;
+        }
+
+        /** Tells if 'event' was (or is being) cancelled before being dispatched */
+        static inline bool isCancelledEvent(const QueueElement& event) {
+        	EventDispatchState dispatchState = event.dispatchState.load(memory_order_acquire);
+        	return (dispatchState == EventDispatchState::CANCELLING) || (dispatchState == EventDispatchState::CANCELLED);
+        }
+
+        /** Overloading protection: events not dispatched within 'timeToLive' from their reservation are not worth consuming anymore, since
+         *  no one will care for their answers -- dispatchers will drop them (not calling consumers nor listeners), failing their waiters with
+         *  'EventExpired', counting them (see 'getNumberOfExpiredEvents()') and notifying 'expiredEventsListener', if set. This way, under
+         *  overload, latencies are kept bounded at the expense of throughput. With a zero 'timeToLive', events only expire if given a
+         *  deadline through 'setEventDeadline(...)'. Until this is called, expiration is disabled. To be called before reporting any events */
+        template <typename _Rep, typename _Period>
+        void setEventsTimeToLive(chrono::duration<_Rep, _Period> timeToLive, const Listener& expiredEventsListener = nullptr) {
+        	this->expiredEventsListener = expiredEventsListener;
+        	eventsTimeToLiveNS          = chrono::duration_cast<chrono::nanoseconds>(timeToLive).count();
+        	if (deadlines == nullptr) {
+        		deadlines = new unsigned long long[numberOfQueueSlots]();
+        	}
+        }
+
+        /** Overrides the deadline stamped by 'setEventsTimeToLive(...)' for the reserved (but not yet reported) 'eventId'. Expiration must
+         *  have been enabled -- with a zero 'timeToLive', only events given a deadline here expire */
+        void setEventDeadline(int eventId, chrono::steady_clock::time_point deadline) {
+        	if (deadlines == nullptr) {
+        		THROW_EXCEPTION(runtime_error, "Attempting to set an event deadline on '" + eventName + "', whose expiration was not enabled by 'setEventsTimeToLive(...)'");
+        	}
+        	deadlines[eventId] = chrono::duration_cast<chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        }
+
+        /** Enables the "single flight" mode for 'reportAndWaitForAnswer(...)': reporters of a parameter identical (according to 'hasher' and
+         *  'comparator') to the one of an event still being reported, queued or consumed won't enqueue a new event -- they will attach to
+         *  the one in flight and receive a copy of its answer (or its exception), sparing the consumers of duplicate work on bursts of
+         *  identical requests. To be called before reporting any events */
+        void setSingleFlight(const ParameterHasher& hasher, const ParameterComparator& comparator) {
+        	scoped_lock<mutex> lock(flightsGuard);
+        	flightParameterHasher     = hasher;
+        	flightParameterComparator = comparator;
+        	if (flights == nullptr) {
+        		flights = new Flight*[numberOfQueueSlots]{};
+        	}
+        }
+
+        /** Places 'cache' (an 'AnswerCache' for this link's parameter & answer types) in front of the consumers: 'reportAndWaitForAnswer(...)'
+         *  calls will be answered from it, on the reporting thread, whenever possible -- and the answers produced by the consumers will be
+         *  stored on it -- unless the cache got an invalidation for them while they were being produced. To be called before reporting any events */
+        template <typename _AnswerCache>
+        void setAnswerCache(_AnswerCache& cache) {
+        	answerCacheLookup = [&cache](const _ArgumentType& eventParameter, _AnswerType* answer, unsigned long long& generation) {
+        		return cache.lookup(eventParameter, answer, generation);
+        	};
+        	answerCacheStore  = [&cache](const _ArgumentType& eventParameter, const _AnswerType& answer, unsigned long long generation) {
+        		return cache.store(eventParameter, answer, generation);
+        	};
+        }
+
+        void unsetAnswerCache() {
+        	answerCacheLookup = nullptr;
+        	answerCacheStore  = nullptr;
+        }
+
+        /** Number of 'reportAndWaitForAnswer(...)' calls answered without enqueueing an event -- see 'setSingleFlight(...)' */
+        unsigned long long getNumberOfCollapsedEvents() {
+        	scoped_lock<mutex> lock(flightsGuard);
+        	return nCollapsedEvents;
+        }
+
+        unsigned long long getNumberOfExpiredEvents() {
+        	return nExpiredEvents.load(memory_order_relaxed);
+        }
+
+        static inline unsigned long long getMonotonicTimeNS() {
+        	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /** Called by dispatchers on events found past their deadlines */
+        void expireEvent(QueueElement& event) {
+        	if (!cancelQueuedEvent<EventExpired>(event, "expired before being consumed")) {
+        		return;
+        	}
+        	nExpiredEvents.fetch_add(1, memory_order_relaxed);
+        	if (expiredEventsListener) {
+        		try {
+        			expiredEventsListener(event.eventParameter);
+        		} catch (const std::exception& e) {
+        			DUMP_EXCEPTION(runtime_error("Exception in expired events listener: "s + e.what()),
+        			               "QueueEventLink '"+eventName+"': exception in expired events listener. Caused by: "s + e.what());
+        		}
+        	}
+        }
+
+        /** Overloading protection: limits the rate at which events may be reserved to 'eventsPerSecond', allowing bursts of up to 'burst'
+         *  events -- a token bucket, kept as a single atomic "theoretical arrival time" (GCRA), so admitting an event is lock-free.
+         *  Events above the limit are counted (see 'getNumberOfRejectedEvents()') and, according to 'policy':
+         *    - REJECT: 'reserveEventForReporting(...)' throws 'EventRejected';
+         *    - DELAY:  'reserveEventForReporting(...)' sleeps until the event's token is available;
+         *    - DIVERT: the event is reserved & reported as usual, but, when reported, it is handed to 'divertedEventsListener' (on the
+         *              reporting thread) instead of reaching the consumers & listeners -- its waiters, if any, get 'EventRejected'.
+         *  An 'eventsPerSecond' of 0 disables the admission control. To be called before reporting any events */
+        void setAdmissionControl(double eventsPerSecond, unsigned int burst, AdmissionPolicy policy = AdmissionPolicy::REJECT, const Listener& divertedEventsListener = nullptr) {
+        	if ( (policy == AdmissionPolicy::DIVERT) && (!divertedEventsListener) ) {
+        		THROW_EXCEPTION(invalid_argument, "QueueEventLink '"+eventName+"': the 'DIVERT' admission policy requires a 'divertedEventsListener'");
+        	}
+        	admissionPolicy              = policy;
+        	this->divertedEventsListener = divertedEventsListener;
+        	admissionIntervalNS          = eventsPerSecond <= 0 ? 0 : (unsigned long long) (1e9 / eventsPerSecond);
+        	admissionCapacityNS          = admissionIntervalNS * (burst == 0 ? 1 : burst);
+        	admissionTheoreticalArrivalNS.store(0, memory_order_relaxed);
+        	if ( (policy == AdmissionPolicy::DIVERT) && (divertedSlots == nullptr) ) {
+        		divertedSlots = new bool[numberOfQueueSlots]();
+        	}
+        }
+
+        /** Number of events reported above the rate allowed by 'setAdmissionControl(...)' -- whether they were rejected, delayed or diverted */
+        unsigned long long getNumberOfRejectedEvents() {
+        	return nRejectedEvents.load(memory_order_relaxed);
+        }
+
+        /** Takes a token from the admission control bucket, returning true if the event may be enqueued -- otherwise applies the
+         *  'admissionPolicy' (returning false only for 'DIVERT') */
+        bool admitEvent() {
+        	unsigned long long nowNS = getMonotonicTimeNS();
+        	unsigned long long theoreticalArrivalNS = admissionTheoreticalArrivalNS.load(memory_order_relaxed);
+        	unsigned long long newTheoreticalArrivalNS;
+        	do {
+        		newTheoreticalArrivalNS = max(theoreticalArrivalNS, nowNS) + admissionIntervalNS;
+        		if ( (newTheoreticalArrivalNS - nowNS > admissionCapacityNS) && (admissionPolicy != AdmissionPolicy::DELAY) ) {
+        			// bucket is empty
+        			nRejectedEvents.fetch_add(1, memory_order_relaxed);
+        			if (admissionPolicy == AdmissionPolicy::REJECT) {
+        				THROW_EXCEPTION(EventRejected, "Event of '"+eventName+"' was rejected by the admission control");
+        			}
+        			return false;
+        		}
+        	} while (!admissionTheoreticalArrivalNS.compare_exchange_weak(theoreticalArrivalNS, newTheoreticalArrivalNS, memory_order_relaxed));
+        	if (unlikely(newTheoreticalArrivalNS - nowNS > admissionCapacityNS)) {
+        		// 'DELAY': the token was taken in advance -- wait for it
+        		nRejectedEvents.fetch_add(1, memory_order_relaxed);
+        		this_thread::sleep_for(chrono::nanoseconds(newTheoreticalArrivalNS - nowNS - admissionCapacityNS));
+        	}
+        	return true;
+        }
+
+        /** Called on reporting an event the admission control didn't admit -- see 'AdmissionPolicy::DIVERT' */
+        void divertEvent(int eventId) {
+        	QueueElement& event = events[eventId];
+        	divertedSlots[eventId] = false;
+        	try {
+        		divertedEventsListener(event.eventParameter);
+        	} catch (const std::exception& e) {
+        		DUMP_EXCEPTION(runtime_error("Exception in diverted events listener: "s + e.what()),
+        		               "QueueEventLink '"+eventName+"': exception in diverted events listener. Caused by: "s + e.what());
+        	}
+        	cancelQueuedEvent<EventRejected>(event, "was diverted by the admission control");
+        }
+
+        /** To be called by dispatchers for each dequeued 'event': calls 'dispatch(event)' -- which consumes & notifies it -- unless it was
+         *  cancelled or expired, with 'event' set as the current thread's one, for 'isCurrentEventCancelled()'.
+         *  With per key ordered dispatching (see 'setKeyOrderedDispatching(...)'), an event dequeued while an earlier event of its lane is
+         *  still being dispatched was deferred into the lane's FIFO: this call returns right away, leaving the thread free for other events,
+         *  and the thread holding the lane dispatches it -- along with any other deferred events -- before leaving it. So no dispatcher
+         *  thread ever waits for a lane. Either way, the caller must release 'event' afterwards, as usual */
+        template <typename _Dispatch>
+        inline void dispatchDequeuedEvent(QueueElement& event, _Dispatch&& dispatch) {
+        	if (likely(lanes == nullptr)) {
+        		if (startDispatching(event)) {
+        			dispatch(event);
+        			finishDispatching(event);
+        		}
+        		return;
+        	}
+        	if (laneSlots[&event - events].isDeferred) {
+        		// the lane holder will dispatch it
+        		return;
+        	}
+        	QueueElement* laneEvent = &event;
+        	do {
+        		if (startDispatching(*laneEvent)) {
+        			dispatch(*laneEvent);
+        			finishDispatching(*laneEvent);
+        		}
+        		QueueElement* nextLaneEvent = leaveLane(*laneEvent);
+        		if (laneEvent != &event) {
+        			// deferred events are released by their dequeuer & by the lane holder
+        			releaseEvent(laneEvent - events);
+        		}
+        		laneEvent = nextLaneEvent;
+        	} while (laneEvent != nullptr);
+        }
+
+        /** Returns false if 'event' was cancelled (or expired) -- and must be skipped. Otherwise, sets it as the current thread's one */
+        inline bool startDispatching(QueueElement& event) {
+        	if (unlikely(deadlines != nullptr) && (deadlines[&event - events] != 0) && (getMonotonicTimeNS() > deadlines[&event - events])) {
+        		expireEvent(event);
+        		waitForCancellation(event);
+        		return false;
+        	}
+        	EventDispatchState queued = EventDispatchState::QUEUED;
+        	if (unlikely(!event.dispatchState.compare_exchange_strong(queued, EventDispatchState::RUNNING, memory_order_acq_rel))) {
+        		waitForCancellation(event);
+        		return false;
+        	}
+        	currentEventDispatchState = &event.dispatchState;
+        	return true;
+        }
+
+        /** Skipped events may only be released after whoever is cancelling them is done with their slots -- see 'cancelQueuedEvent(...)' */
+        inline void waitForCancellation(QueueElement& event) {
+        	while (event.dispatchState.load(memory_order_acquire) == EventDispatchState::CANCELLING) {
+        		this_thread::yield();
+        	}
+        }
+
+        /** To be called after consuming & notifying an event 'startDispatching(...)' accepted */
+        inline void finishDispatching(QueueElement& event) {
+        	currentEventDispatchState = nullptr;
+        	event.dispatchState.store(EventDispatchState::DISPATCHED, memory_order_release);
+        }
+
+        /** Enables the per key ordered dispatching: events whose 'keyExtractor' results are equal (an account id, for instance) are consumed
+         *  strictly in the order they were reserved, even if there are several dispatcher threads -- while events of different keys are
+         *  consumed in parallel. Keys are hashed into 'nLanes' lanes: events dequeued while an earlier event of their lane is being
+         *  dispatched are deferred into the lane's FIFO, to be dispatched by the thread holding the lane -- see 'dispatchDequeuedEvent(...)' --
+         *  so unrelated keys sharing a lane will also be ordered among themselves. To be called before any events are reported */
+        void setKeyOrderedDispatching(const KeyExtractor& keyExtractor, unsigned int nLanes = 64) {
+        	scoped_lock<mutex> lock(queueGuard);
+        	delete[] lanes;
+        	laneKeyExtractor = keyExtractor;
+        	lanes            = new Lane[nLanes];
+        	this->nLanes     = nLanes;
+        	for (unsigned int i=0; i<nLanes; i++) {
+        		lanes[i].isBusy             = false;
+        		lanes[i].firstDeferredEvent = -1;
+        		lanes[i].lastDeferredEvent  = -1;
+        	}
+        	if (laneSlots == nullptr) {
+        		laneSlots = new LaneSlot[numberOfQueueSlots]();
+        	}
+        	allocatePendingReleases();
+        }
+
+        /** Enables conflation for 'reportConflatedEvent(...)': events whose 'keyExtractor' results are equal (an instrument id, a device id, ...)
+         *  are versions of the same status -- of which only the latest matters. If an event for the same key is still waiting to be dequeued,
+         *  its parameter is overwritten in place (keeping its position on the queue) instead of a new slot being taken: so slow consumers and
+         *  listeners don't fall behind the update rate and the queue depth is bounded by the number of distinct keys.
+         *  Events are only overwritten while no one may be reading them: not before they are published, nor once dequeued (or dispatched
+         *  inline) -- and never on links with multicast cursors, which read events as soon as they are published.
+         *  'keyExtractor' must give distinct results for distinct keys. To be called before any events are reported */
+        void setConflation(const KeyExtractor& keyExtractor) {
+        	scoped_lock<mutex> lock(queueGuard);
+        	conflationKeyExtractor = keyExtractor;
+        	if (conflationBuckets == nullptr) {
+        		conflationBuckets = new int[numberOfQueueSlots];
+        		conflationSlots   = new ConflationSlot[numberOfQueueSlots]();
+        		for (unsigned int i=0; i<numberOfQueueSlots; i++) {
+        			conflationBuckets[i] = -1;
+        		}
+        	}
+        }
+
+        /** Reports an answerless event for 'eventParameter' or, if conflation is enabled (see 'setConflation(...)') and an event for the same key
+         *  is still waiting to be dequeued, replaces that event's parameter. Returns the 'eventId' */
+        int reportConflatedEvent(const _ArgumentType& eventParameter) {
+        	size_t conflationKey = 0;
+        	if (likely(conflationBuckets != nullptr)) {
+        		conflationKey = conflationKeyExtractor(eventParameter);
+        		queueGuard.lock();
+        		for (int eventId = conflationBuckets[conflationKey & queueSlotsModulus]; eventId != -1; eventId = conflationSlots[eventId].nextConflatedEvent) {
+        			if (conflationSlots[eventId].conflationKey == conflationKey) {
+        				events[eventId].eventParameter = eventParameter;
+        				nConflatedEvents++;
+        				queueGuard.unlock();
+        				return eventId;
+        			}
+        		}
+        		queueGuard.unlock();
+        	}
+        	_ArgumentType* reservedParameterReference;
+        	int eventId = reserveEventForReporting(reservedParameterReference);
+        	*reservedParameterReference = eventParameter;
+        	if (likely(conflationSlots != nullptr)) {
+        		conflationSlots[eventId].conflationKey = conflationKey;
+        	}
+        	reportReservedEvent(eventId, conflationSlots != nullptr);
+        	return eventId;
+        }
+
+        /** Number of 'reportConflatedEvent(...)' calls that replaced a pending event, rather than reporting a new one */
+        unsigned long long getNumberOfConflatedEvents() {
+        	scoped_lock<mutex> lock(queueGuard);
+        	return nConflatedEvents;
+        }
+
+        /** To be called, with 'queueGuard' locked, as the conflatable 'eventId' gets published: from now on, and until it is dequeued,
+         *  updates for its key go to its parameter */
+        inline void indexConflatableEvent(int eventId) {
+        	ConflationSlot& conflationSlot = conflationSlots[eventId];
+        	int&            bucket         = conflationBuckets[conflationSlot.conflationKey & queueSlotsModulus];
+        	conflationSlot.nextConflatedEvent = bucket;
+        	conflationSlot.isConflatable      = true;
+        	bucket = eventId;
+        }
+
+        /** To be called, with 'queueGuard' locked, as 'eventId' gets dequeued: it may no longer be updated in place */
+        inline void unindexConflatableEvent(int eventId) {
+        	if (likely(conflationSlots == nullptr) || (!conflationSlots[eventId].isConflatable)) {
+        		return;
+        	}
+        	ConflationSlot& conflationSlot = conflationSlots[eventId];
+        	conflationSlot.isConflatable = false;
+        	int* previous = &conflationBuckets[conflationSlot.conflationKey & queueSlotsModulus];
+        	while (*previous != eventId) {
+        		previous = &conflationSlots[*previous].nextConflatedEvent;
+        	}
+        	*previous = conflationSlot.nextConflatedEvent;
+        }
+
+        /** To be called, with 'queueGuard' locked, as 'eventId' gets dequeued: takes its lane, if free -- otherwise, defers the event into the
+         *  lane's FIFO (in dequeueing order, so the key order is kept), leaving it to be dispatched & released by the lane holder as well */
+        inline void enterLane(int eventId) {
+        	if (likely(lanes == nullptr)) {
+        		return;
+        	}
+        	LaneSlot& laneSlot = laneSlots[eventId];
+        	Lane&     lane     = lanes[laneSlot.lane];
+        	scoped_lock<mutex> lock(lane.guard);
+        	laneSlot.nextDeferredEvent = -1;
+        	if (!lane.isBusy) {
+        		lane.isBusy         = true;
+        		laneSlot.isDeferred = false;
+        		return;
+        	}
+        	laneSlot.isDeferred = true;
+        	pendingReleases[eventId].fetch_add(1, memory_order_relaxed);
+        	if (lane.lastDeferredEvent == -1) {
+        		lane.firstDeferredEvent = eventId;
+        	} else {
+        		laneSlots[lane.lastDeferredEvent].nextDeferredEvent = eventId;
+        	}
+        	lane.lastDeferredEvent = eventId;
+        }
+
+        /** Called by the lane holder after dispatching 'event': returns the next deferred event of the lane -- which the holder must
+         *  dispatch next -- or frees the lane & returns nullptr if there are none */
+        inline QueueElement* leaveLane(QueueElement& event) {
+        	Lane& lane = lanes[laneSlots[&event - events].lane];
+        	scoped_lock<mutex> lock(lane.guard);
+        	int nextEventId = lane.firstDeferredEvent;
+        	if (nextEventId == -1) {
+        		lane.isBusy = false;
+        		return nullptr;
+        	}
+        	lane.firstDeferredEvent = laneSlots[nextEventId].nextDeferredEvent;
+        	if (lane.firstDeferredEvent == -1) {
+        		lane.lastDeferredEvent = -1;
+        	}
+        	return &events[nextEventId];
+        }
+
+        [[noreturn]] void throwClosedLinkException() {
+        	THROW_EXCEPTION(runtime_error, "Attempting to report an event on '" + eventName + "', which was closed (its dispatchers are stopping or were stopped)");
+        }
+
+        /** Blocks the calling thread until the answer for the answerfull 'eventId' is ready, returning it -- or rethrowing the exception
+         *  the consumer threw before producing it. See 'answer(...)' for a version which suspends a coroutine instead */
         inline _AnswerType* waitForAnswer(int eventId) {
             QueueElement& event                = events[eventId];
             _AnswerType* answerObjectReference = event.answerObjectReference;
             if (answerObjectReference == nullptr) {
-                THROW_EXCEPTION(runtime_error, "Attempting to wait for an answer from an event of '" + eventName + "', which was not prepared to produce an answer. "
-                                               "Did you call 'reserveEventForReporting(_ArgumentType)' instead of 'reserveEventForReporting(_ArgumentType&, const _AnswerType&)' ?");
+                throwNotAnswerfullException();
             }
             event.answerMutex.lock();	// wait until the answer is ready (the answerfull consumer must unlock the mutex as soon as the answer is ready)
             event.answerMutex.unlock();
+            return collectAnswer(event, answerObjectReference);
+        }
+
+        /** Same as above, but giving up after 'timeout' -- in which case nullptr is returned and the event remains pending (see 'cancelEvent(...)').
+         *  Waiting happens through the event continuation, so it can't be mixed with 'answer(...)' nor answer handlers */
+        template <typename _Rep, typename _Period>
+        _AnswerType* waitForAnswer(int eventId, chrono::duration<_Rep, _Period> timeout) {
+            QueueElement& event = events[eventId];
+            if (event.answerObjectReference == nullptr) {
+                throwNotAnswerfullException();
+            }
+            if (event.hasAnswerHandler || (event.completionState.load(memory_order_acquire) == CONTINUATION_SET)) {
+                THROW_EXCEPTION(runtime_error, "Attempting to wait for an answer from an event of '" + eventName + "', which is already being awaited through its continuation");
+            }
+            timed_mutex answerGuard;
+            answerGuard.lock();
+            if (trySetContinuation(event, Continuation([&answerGuard]() { answerGuard.unlock(); })) &&
+                !answerGuard.try_lock_for(timeout)) {
+                uint8_t continuationSet = CONTINUATION_SET;
+                if (event.completionState.compare_exchange_strong(continuationSet, PENDING, memory_order_acq_rel)) {
+                    // timed out -- and the continuation was withdrawn
+                    return nullptr;
+                }
+                // completed meanwhile: wait for the continuation to let go of 'answerGuard'
+                answerGuard.lock();
+            }
+            answerGuard.unlock();
+            return waitForAnswer(eventId);
+        }
+
+        /** Reports an answerfull event for 'eventParameter' and waits for its answer, which is stored in 'answerObjectReference' -- returned
+         *  for convenience. Exceptions thrown by the consumer are rethrown here. If 'setSingleFlight(...)' was called and an identical event is
+         *  in flight, no new event is reported: 'answerObjectReference' receives a copy of that event's answer. If 'setAnswerCache(...)'
+         *  was called, a cached answer is copied instead, without reporting anything */
+        _AnswerType* reportAndWaitForAnswer(const _ArgumentType& eventParameter, _AnswerType* answerObjectReference) {
+            if (unlikely((bool)answerCacheLookup)) {
+                unsigned long long cacheGeneration;
+                if (answerCacheLookup(eventParameter, answerObjectReference, cacheGeneration)) {
+                    return answerObjectReference;
+                }
+                reportAndWaitForUncachedAnswer(eventParameter, answerObjectReference);
+                answerCacheStore(eventParameter, *answerObjectReference, cacheGeneration);
+                return answerObjectReference;
+            }
+            return reportAndWaitForUncachedAnswer(eventParameter, answerObjectReference);
+        }
+
+        _AnswerType* reportAndWaitForUncachedAnswer(const _ArgumentType& eventParameter, _AnswerType* answerObjectReference) {
+            if (!flightParameterHasher) {
+                _ArgumentType* reservedParameterReference;
+                int eventId = reserveEventForReporting(reservedParameterReference, answerObjectReference);
+                *reservedParameterReference = eventParameter;
+                reportReservedEvent(eventId);
+                return waitForAnswer(eventId);
+            }
+
+            size_t  parameterHash = flightParameterHasher(eventParameter);
+            Flight** bucket       = &flights[parameterHash & queueSlotsModulus];
+            flightsGuard.lock();
+            for (Flight* flight = *bucket; flight != nullptr; flight = flight->next) {
+                if ( (flight->parameterHash == parameterHash) && flightParameterComparator(*flight->eventParameter, eventParameter) ) {
+                    // take this flight
+                    FlightPassenger passenger;
+                    passenger.answerObjectReference = answerObjectReference;
+                    passenger.exception             = nullptr;
+                    passenger.next                  = flight->passengers;
+                    passenger.landingGuard.lock();
+                    flight->passengers = &passenger;
+                    nCollapsedEvents++;
+                    flightsGuard.unlock();
+                    passenger.landingGuard.lock();	// 2nd lock. Wait here until the flight lands
+                    passenger.landingGuard.unlock();
+                    if (passenger.exception != nullptr) {
+                        std::rethrow_exception(passenger.exception);
+                    }
+                    return answerObjectReference;
+                }
+            }
+            // take off
+            Flight flight = {parameterHash, &eventParameter, nullptr, *bucket};
+            *bucket = &flight;
+            flightsGuard.unlock();
+
+            exception_ptr exception = nullptr;
+            try {
+                _ArgumentType* reservedParameterReference;
+                int eventId = reserveEventForReporting(reservedParameterReference, answerObjectReference);
+                *reservedParameterReference = eventParameter;
+                reportReservedEvent(eventId);
+                waitForAnswer(eventId);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+
+            // land: no more passengers may take this flight
+            flightsGuard.lock();
+            Flight** previous = bucket;
+            while (*previous != &flight) {
+                previous = &(*previous)->next;
+            }
+            *previous = flight.next;
+            flightsGuard.unlock();
+            FlightPassenger* passenger = flight.passengers;
+            while (passenger != nullptr) {
+                FlightPassenger* nextPassenger = passenger->next;	// 'passenger' is gone as soon as it is unlocked
+                if (exception != nullptr) {
+                    passenger->exception = exception;
+                } else {
+                    *passenger->answerObjectReference = *answerObjectReference;
+                }
+                passenger->landingGuard.unlock();
+                passenger = nextPassenger;
+            }
+
+            if (exception != nullptr) {
+                std::rethrow_exception(exception);
+            }
+            return answerObjectReference;
+        }
+
+        [[noreturn]] void throwNotAnswerfullException() {
+            THROW_EXCEPTION(runtime_error, "Attempting to wait for an answer from an event of '" + eventName + "', which was not prepared to produce an answer. "
+                                           "Did you call 'reserveEventForReporting(_ArgumentType)' instead of 'reserveEventForReporting(_ArgumentType&, const _AnswerType&)' ?");
+        }
+
+        /** Returns the answer of an event known to be answered -- or rethrows the exception that prevented it from being produced */
+        inline _AnswerType* collectAnswer(QueueElement& event, _AnswerType* answerObjectReference) {
             // checks for any exception that might have been thrown
             if (event.exception != nullptr) {
-                if (!answerObjectReference) {
-                    // exception happened before issuing the answer -- stop the thread flow.
+                if ( (event.answerObjectReference == nullptr) || isCancelledEvent(event) ) {
+                    // exception happened before issuing the answer (or the event was cancelled) -- stop the thread flow.
                     std::rethrow_exception(event.exception);
                 } else {
                     // exception happened after issuing the answer -- we'll continue with a warning.
@@ -442,6 +1684,136 @@ namespace mutua::events {
             }
             return answerObjectReference;
         }
+
+        /** Called by the dispatchers once the answerfull consumer for 'event' returns (or by 'discardLeftoverEvents()', for the events
+         *  that will never be consumed): resumes the coroutine awaiting it, if any. Completion is a lock free state machine --
+         *  PENDING -> COMPLETED if no one is awaiting or PENDING -> SETTING_CONTINUATION -> CONTINUATION_SET -> COMPLETED, calling
+         *  the continuation. See 'trySetContinuation(...)' */
+        inline void completeAnswerfullEvent(QueueElement& event) {
+            if (event.completionState.exchange(COMPLETED, memory_order_acq_rel) == CONTINUATION_SET) {
+                continuations[&event - events]();
+            }
+        }
+
+        /** Sets 'continuation' to be called on the completion of 'event' -- returning false, without setting it, if 'event' is no longer
+         *  pending (already completed or having a continuation already). The continuation is only written after the PENDING state is claimed,
+         *  so it never overwrites an answer handler's one; a completion happening before it gets published calls nothing, failing the claim */
+        inline bool trySetContinuation(QueueElement& event, const Continuation& continuation) {
+            allocateContinuations();
+            uint8_t expectedState = PENDING;
+            if (!event.completionState.compare_exchange_strong(expectedState, SETTING_CONTINUATION, memory_order_acq_rel)) {
+                return false;
+            }
+            continuations[&event - events] = continuation;
+            expectedState      = SETTING_CONTINUATION;
+            return event.completionState.compare_exchange_strong(expectedState, CONTINUATION_SET, memory_order_acq_rel);
+        }
+
+        /** Identifies an answerfull event to be waited for along with others, possibly from different links -- see 'AnswerGroups.h' */
+        struct AnswerHandle {
+            QueueEventLink* link;
+            int             eventId;
+
+            _AnswerType* waitForAnswer() const {
+                return link->waitForAnswer(eventId);
+            }
+
+            bool cancel() const {
+                return link->cancelEvent(eventId);
+            }
+        };
+
+        AnswerHandle getAnswerHandle(int eventId) {
+            return AnswerHandle{this, eventId};
+        }
+
+        /** 'co_await'able for the answer of an answerfull event: suspends the awaiting coroutine until the consumer returns,
+         *  resuming it through 'executor'. Yields the answer pointer -- or throws what the consumer threw before answering */
+        struct AnswerAwaiter {
+            QueueEventLink&         link;
+            int                     eventId;
+            _AnswerType*            answerObjectReference;
+            const CoroutineExecutor executor;
+            std::coroutine_handle<> awaitingCoroutine;
+
+            bool await_ready() {
+                return link.events[eventId].completionState.load(memory_order_acquire) == COMPLETED;
+            }
+
+            bool await_suspend(std::coroutine_handle<> coroutine) {
+                awaitingCoroutine = coroutine;
+                // if the event got completed in the meantime, don't suspend
+                return link.trySetContinuation(link.events[eventId], Continuation::template fromMethod<&AnswerAwaiter::resume>(this));
+            }
+
+            _AnswerType* await_resume() {
+                return link.collectAnswer(link.events[eventId], answerObjectReference);
+            }
+
+            void resume() {
+                if (executor) {
+                    executor(awaitingCoroutine);
+                } else {
+                    awaitingCoroutine.resume();
+                }
+            }
+        };
+
+        /** 'co_await'able that reports an answerfull event with a copy of 'eventParameter' and awaits its answer -- yielding it by value.
+         *  Note that reporting may block the thread if the queue is full */
+        struct ReportAndAwaitAwaiter: AnswerAwaiter {
+            _ArgumentType eventParameter;
+            _AnswerType   answer;
+
+            bool await_ready() {
+                _ArgumentType* eventParameterPointer;
+                this->eventId               = this->link.reserveEventForReporting(eventParameterPointer, &answer);
+                this->answerObjectReference = &answer;
+                // the answer goes to the awaiting coroutine: bypass the link's answer handler, if any -- the event is not reported yet
+                this->link.unregisterAnswerHandler(this->link.events[this->eventId]);
+                *eventParameterPointer      = eventParameter;
+                this->link.reportReservedEvent(this->eventId);
+                return AnswerAwaiter::await_ready();
+            }
+
+            _AnswerType await_resume() {
+                return *AnswerAwaiter::await_resume();
+            }
+        };
+
+        /** Sets the default executor coroutines awaiting answers are resumed on -- typically, a delegate posting the coroutine handle
+         *  to a thread pool. If not set, coroutines are resumed on the thread completing the event (usually a dispatcher thread) */
+        void setCoroutineExecutor(const CoroutineExecutor& executor) {
+            coroutineExecutor = executor;
+        }
+
+        /** 'co_await link.answer(eventId)' suspends the calling coroutine -- instead of blocking the thread, like 'waitForAnswer(...)' does --
+         *  until the answer for 'eventId' is ready, resuming it through 'executor' (or through the link's default executor).
+         *  Please note that the coroutine is resumed once the answerfull consumer returns, even if it published the answer before that. */
+        AnswerAwaiter answer(int eventId, const CoroutineExecutor& executor) {
+            _AnswerType* answerObjectReference = events[eventId].answerObjectReference;
+            if (answerObjectReference == nullptr) {
+                throwNotAnswerfullException();
+            }
+            if (events[eventId].hasAnswerHandler) {
+                THROW_EXCEPTION(runtime_error, "Attempting to await an answer from an event of '" + eventName + "', which has an 'AnswerHandler' -- it will be delivered to it.");
+            }
+            return AnswerAwaiter{*this, eventId, answerObjectReference, executor, nullptr};
+        }
+
+        AnswerAwaiter answer(int eventId) {
+            return answer(eventId, coroutineExecutor);
+        }
+
+        /** 'co_await link.reportAndAwait(eventParameter)' reports an answerfull event and suspends the calling coroutine until it is answered,
+         *  yielding the answer -- so many requests may await their answers without needing a thread each. See 'answer(...)' */
+        ReportAndAwaitAwaiter reportAndAwait(const _ArgumentType& eventParameter, const CoroutineExecutor& executor) {
+            return ReportAndAwaitAwaiter{{*this, -1, nullptr, executor, nullptr}, eventParameter, {}};
+        }
+
+        ReportAndAwaitAwaiter reportAndAwait(const _ArgumentType& eventParameter) {
+            return reportAndAwait(eventParameter, coroutineExecutor);
+        }
     };
 }
 
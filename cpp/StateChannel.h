@@ -0,0 +1,181 @@
+#ifndef MUTUA_EVENTS_STATECHANNEL_H_
+#define MUTUA_EVENTS_STATECHANNEL_H_
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <type_traits>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+#include "EventDelegate.h"
+
+
+namespace mutua::events {
+
+	/**
+     * StateChannel.h
+     * ==============
+     *
+     * Latest-value link, for "events" that are really shared state (configuration snapshots, current load figures, ...) read
+     * constantly by many threads: instead of being queued & fanned out to listeners, each published value simply replaces the
+     * previous one, behind a seqlock:
+     *
+     *   - the writer bumps the (odd while writing) sequence, copies the value & bumps it again -- never waiting for readers;
+     *   - readers copy the value and retry if the sequence changed meanwhile. 'tryRead(...)' is the wait-free, single attempt;
+     *   - 'waitForChange(...)' puts the reader to sleep until a version newer than the one it knows is published;
+     *   - listeners are called, on the channel's own thread, with the latest value whenever it changed since they were last called --
+     *     edge-triggered: versions published while they run are coalesced into a single notification.
+     *
+     * As readers may copy a value while it is being overwritten (only to discard the copy), '_StateType' must be trivially copyable.
+     *
+    */
+	template <typename _StateType>
+	class StateChannel {
+
+		static_assert(std::is_trivially_copyable<_StateType>::value, "StateChannel: '_StateType' must be trivially copyable, as readers may copy it while it is being written");
+
+	public:
+
+		typedef EventDelegate<void (const _StateType&)> Listener;
+
+		constexpr static unsigned long long closedSequenceBit = 1ull << 63;	// set on 'sequence' by 'close()'
+
+		string eventName;
+
+
+	private:
+
+		alignas(64) atomic<unsigned long long> sequence;	// 2 * version -- odd while a value is being written
+		alignas(64) _StateType state;
+		mutex            writersGuard;		// writers only wait for each other
+		vector<Listener> listeners;
+		thread           notifierThread;
+
+
+	public:
+
+		/** Creates a channel holding 'initialState' as version 0. 'listeners', if any, get notified of every change from then on */
+		StateChannel(string eventName, const _StateType& initialState = {}, vector<Listener> listeners = {})
+				: eventName (eventName)
+				, sequence  (0)
+				, state     (initialState)
+				, listeners (listeners) {
+			if (listeners.size() > 0) {
+				notifierThread = thread(&StateChannel::notificationLoop, this);
+			}
+		}
+
+		~StateChannel() {
+			close();
+			if (notifierThread.joinable()) {
+				notifierThread.join();
+			}
+		}
+
+		/** Replaces the current state with 'newState', returning its version */
+		unsigned long long publish(const _StateType& newState) {
+			scoped_lock<mutex> lock(writersGuard);
+			unsigned long long currentSequence = sequence.load(memory_order_relaxed);
+			if (currentSequence & closedSequenceBit) {
+				THROW_EXCEPTION(runtime_error, "StateChannel '"+eventName+"': can't publish on a closed channel");
+			}
+			sequence.store(currentSequence+1, memory_order_relaxed);
+			atomic_thread_fence(memory_order_release);
+			state = newState;
+			sequence.store(currentSequence+2, memory_order_release);
+			sequence.notify_all();
+			return (currentSequence+2) / 2;
+		}
+
+		/** Wait-free: copies the current state into 'stateCopy' and sets 'version' -- unless a value was being written meanwhile,
+		 *  in which case false is returned and 'stateCopy' must be disregarded */
+		bool tryRead(_StateType& stateCopy, unsigned long long& version) {
+			unsigned long long startSequence = sequence.load(memory_order_acquire) & ~closedSequenceBit;
+			if (startSequence & 1) {
+				return false;
+			}
+			stateCopy = state;
+			atomic_thread_fence(memory_order_acquire);
+			unsigned long long endSequence = sequence.load(memory_order_relaxed) & ~closedSequenceBit;
+			if (endSequence != startSequence) {
+				return false;
+			}
+			version = startSequence / 2;
+			return true;
+		}
+
+		/** Copies the current state into 'stateCopy', retrying while it is being written. Returns its version */
+		unsigned long long read(_StateType& stateCopy) {
+			unsigned long long version;
+			while (!tryRead(stateCopy, version)) {
+				this_thread::yield();
+			}
+			return version;
+		}
+
+		/** The version of the current state -- increased on every 'publish(...)', so readers may poll for changes without copying the state */
+		unsigned long long getVersion() {
+			return (sequence.load(memory_order_acquire) & ~closedSequenceBit) / 2;
+		}
+
+		/** Sleeps until a version newer than 'knownVersion' is published, then copies it into 'stateCopy' and updates 'knownVersion'.
+		 *  Returns false (and leaves the arguments untouched) if the channel got closed with no newer versions */
+		bool waitForChange(unsigned long long& knownVersion, _StateType& stateCopy) {
+			while (true) {
+				unsigned long long currentSequence = sequence.load(memory_order_acquire);
+				if ((currentSequence & ~closedSequenceBit) / 2 > knownVersion) {
+					knownVersion = read(stateCopy);
+					return true;
+				}
+				if (currentSequence & closedSequenceBit) {
+					return false;
+				}
+				sequence.wait(currentSequence, memory_order_acquire);
+			}
+		}
+
+		/** Wakes up any 'waitForChange(...)' callers & ends the listeners' notifications -- after notifying them of the latest version */
+		void close() {
+			scoped_lock<mutex> lock(writersGuard);
+			sequence.fetch_or(closedSequenceBit, memory_order_release);
+			sequence.notify_all();
+		}
+
+		bool isClosed() {
+			return sequence.load(memory_order_relaxed) & closedSequenceBit;
+		}
+
+	private:
+
+		void notificationLoop() {
+			unsigned long long knownVersion = 0;
+			_StateType         stateCopy;
+			while (waitForChange(knownVersion, stateCopy)) {
+				notifyListeners(stateCopy);
+			}
+		}
+
+		inline void notifyListeners(const _StateType& stateCopy) {
+			for (unsigned int i=0; i<listeners.size(); i++) try {
+				listeners[i](stateCopy);
+			} catch (const exception& e) {
+				DUMP_EXCEPTION(runtime_error("Exception in state listener: "s + e.what()),
+				               "StateChannel '"+eventName+"': exception in state listener #"+to_string(i)+".\n" +
+				               "Caused by: "+e.what());
+			} catch (...) {
+				DUMP_EXCEPTION(runtime_error("Unknown Exception in state listener"),
+				               "StateChannel '"+eventName+"': exception in state listener #"+to_string(i)+".\n" +
+				               "Caused by: <<unknown cause>>");
+			}
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_STATECHANNEL_H_ */
@@ -0,0 +1,272 @@
+#ifndef MUTUA_EVENTS_STATICQUEUEEVENTDISPATCHER_H_
+#define MUTUA_EVENTS_STATICQUEUEEVENTDISPATCHER_H_
+
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+#include "QueueEventDispatcher.h"
+
+
+// linux kernel macros for optimizing branch instructions
+#define likely(x)       __builtin_expect((x),1)
+#define unlikely(x)     __builtin_expect((x),0)
+
+namespace mutua::events {
+
+	/** Compile time information about the consumer method given to 'StaticQueueEventDispatcher'.
+	 *  Only the specializations below are defined -- any other consumer signature is a compile error. */
+	template <auto _ConsumerMethod>
+	struct ConsumerMethodTraits;
+
+	/** no consumer: events are only notified to the listeners */
+	template <>
+	struct ConsumerMethodTraits<nullptr> {
+		typedef void _ConsumerClass;
+		static constexpr bool isAnswerless = false;
+		static constexpr bool isAnswerfull = false;
+	};
+
+	/** answerless consumer: void _Class::method(const _ArgumentType&) */
+	template <typename _Class, typename _ArgumentType, void (_Class::*_ConsumerMethod) (const _ArgumentType&)>
+	struct ConsumerMethodTraits<_ConsumerMethod> {
+		typedef _Class        _ConsumerClass;
+		typedef _ArgumentType _ConsumerArgumentType;
+		static constexpr bool isAnswerless = true;
+		static constexpr bool isAnswerfull = false;
+	};
+
+	/** answerfull consumer: void _Class::method(const _ArgumentType&, _AnswerType*, std::mutex&) */
+	template <typename _Class, typename _ArgumentType, typename _AnswerType, void (_Class::*_ConsumerMethod) (const _ArgumentType&, _AnswerType*, std::mutex&)>
+	struct ConsumerMethodTraits<_ConsumerMethod> {
+		typedef _Class        _ConsumerClass;
+		typedef _ArgumentType _ConsumerArgumentType;
+		typedef _AnswerType   _ConsumerAnswerType;
+		static constexpr bool isAnswerless = false;
+		static constexpr bool isAnswerfull = true;
+	};
+
+	/**
+     * StaticQueueEventDispatcher.h
+     * ============================
+     *
+     * Compile-time counterpart of 'QueueEventDispatcher': the consumer method and the dispatching policies are template
+     * parameters, so the consumer body may be inlined into the dispatching loop and unsupported combinations are
+     * detected by the compiler rather than by a runtime exception. Usage:
+     *
+     *    StaticQueueEventDispatcher<decltype(myLink), &MyConsumer::consume, true> myDispatcher(myLink, {&c1, &c2, &c3, &c4});
+     *
+     * '_ConsumerMethod' may be 'nullptr' for links whose events are only notified to listeners -- which are still
+     * registered, at runtime, on the 'QueueEventLink'.
+     *
+    */
+	template <class _QueueEventLink, auto _ConsumerMethod, bool _NotifyEvents = true>
+	struct StaticQueueEventDispatcher {
+
+		// types from _QueueEventLink:
+		typedef decltype(_QueueEventLink::QueueElement::eventParameter)                _ArgumentType;
+		typedef typename _QueueEventLink::QueueElement                                 QueueElement;
+		// types from _ConsumerMethod:
+		typedef ConsumerMethodTraits<_ConsumerMethod>                                  _ConsumerTraits;
+		typedef typename _ConsumerTraits::_ConsumerClass                               _ConsumerClass;
+
+		static_assert(_NotifyEvents || _ConsumerTraits::isAnswerless || _ConsumerTraits::isAnswerfull,
+		              "StaticQueueEventDispatcher: nothing to dispatch -- either give a consumer method or set '_NotifyEvents'");
+
+		atomic<bool>     isActive;
+		_QueueEventLink& el;
+		int              nThreads;
+		thread*          threads;
+		_ConsumerClass** consumerThese;		// the consumer instance pool -- thread 'i' owns 'consumerThese[i]'
+		bool             areThreadsJoined;
+		unsigned int     nLeftoverEvents;	// filled in when the threads are joined -- see 'joinThreads()'
+
+		string (*eventParameterToStringSerializer) (const _ArgumentType&);
+
+
+		/** Instantiate a dispatcher with 'nThreads' dispatching threads, each one consuming events with its own consumer instance --
+		 *  'consumerInstances' must, therefore, have at least 'nThreads' elements. Use an empty 'consumerInstances' when '_ConsumerMethod' is 'nullptr' */
+		StaticQueueEventDispatcher(_QueueEventLink& el, vector<_ConsumerClass*> consumerInstances, int nThreads)
+				: isActive      (true)
+				, el            (el)
+				, nThreads      (nThreads)
+				, threads          (nullptr)
+				, consumerThese    (nullptr)
+				, areThreadsJoined (false)
+				, nLeftoverEvents  (0) {
+
+			if constexpr (_ConsumerTraits::isAnswerless || _ConsumerTraits::isAnswerfull) {
+				static_assert(std::is_same<typename _ConsumerTraits::_ConsumerArgumentType, _ArgumentType>::value,
+				              "StaticQueueEventDispatcher: the consumer method's argument type differs from the QueueEventLink's one");
+				if (nThreads > (int) consumerInstances.size()) {
+					THROW_EXCEPTION(runtime_error, "StaticQueueEventDispatcher: Attempting to create a dispatcher for event '"+el.eventName+"' with "+to_string(nThreads)+" threads, " +
+					                               "but only "+to_string(consumerInstances.size())+" consumer objects were given on the instance pool. Please, arrange that -- " +
+					                               "most probably by increasing the vector of consumer objects given to this constructor.");
+				}
+			}
+			if constexpr (_ConsumerTraits::isAnswerfull) {
+				static_assert(std::is_same<typename _ConsumerTraits::_ConsumerAnswerType*, decltype(_QueueEventLink::QueueElement::answerObjectReference)>::value,
+				              "StaticQueueEventDispatcher: the answerfull consumer method's answer type differs from the QueueEventLink's one");
+			}
+
+			setArgumentSerializer();
+
+			consumerThese = new _ConsumerClass*[consumerInstances.size()+1];
+			for (unsigned int i=0; i<consumerInstances.size(); i++) {
+				consumerThese[i] = consumerInstances[i];
+			}
+
+			threads = new thread[nThreads];
+			for (int i=0; i<nThreads; i++) {
+				threads[i] = thread(&StaticQueueEventDispatcher::dispatchZeroCopyEventsLoop, this, i, consumerInstances.empty() ? nullptr : consumerThese[i]);
+			}
+		}
+
+		/** Instantiate a dispatcher with one dispatching thread per given consumer instance */
+		StaticQueueEventDispatcher(_QueueEventLink& el, vector<_ConsumerClass*> consumerInstances)
+				: StaticQueueEventDispatcher(el, consumerInstances, consumerInstances.size()) {}
+
+		~StaticQueueEventDispatcher() {
+			stopASAP();
+			delete[] threads;
+			delete[] consumerThese;
+		}
+
+		void setArgumentSerializer() {
+			if constexpr (std::is_integral<_ArgumentType>::value || std::is_constructible<std::string, _ArgumentType>::value) {
+				eventParameterToStringSerializer = static_cast<string (*) (const _ArgumentType&)>(QueueEventDispatcher<_QueueEventLink>::defaultEventParameterToStringSerializer);
+			} else {
+				eventParameterToStringSerializer = _ArgumentType::toString;
+			}
+		}
+
+		inline bool isMutexLocked(mutex& m) {
+			bool isLocked = !m.try_lock();
+			if (!isLocked) m.unlock();
+			return isLocked;
+		}
+
+		/** Stops accepting new events on the link and causes all threads not to process any further elements from this point on
+		 *  -- see 'QueueEventDispatcher::stopASAP()'. Returns the number of leftover events */
+		unsigned int stopASAP() {
+			isActive = false;
+			el.close();
+			return joinThreads();
+		}
+
+		/** Drain protocol -- see 'QueueEventDispatcher::stopWhenEmpty()'. Returns the number of leftover events */
+		unsigned int stopWhenEmpty() {
+			el.close();
+			return joinThreads();
+		}
+
+		unsigned int joinThreads() {
+			if (!areThreadsJoined) {
+				for (int i=0; i<nThreads; i++) {
+					threads[i].join();
+				}
+				isActive         = false;
+				nLeftoverEvents  = el.discardLeftoverEvents();
+				areThreadsJoined = true;
+			}
+			return nLeftoverEvents;
+		}
+
+		/** Calls the consumer method on 'consumerThis' -- the call is resolved at compile time and may be inlined */
+		inline void consumeEvent(unsigned int threadId, _ConsumerClass* consumerThis, QueueElement* dequeuedEvent) {
+			try {
+				if constexpr (_ConsumerTraits::isAnswerless) {
+					(consumerThis->*_ConsumerMethod)(dequeuedEvent->eventParameter);
+				} else if constexpr (_ConsumerTraits::isAnswerfull) {
+					(consumerThis->*_ConsumerMethod)(dequeuedEvent->eventParameter, dequeuedEvent->answerObjectReference, dequeuedEvent->answerMutex);
+				}
+			} catch (const exception& e) {
+				dequeuedEvent->exception = std::current_exception();
+				DUMP_EXCEPTION(runtime_error("Exception in consumer: "s + e.what()),
+				               "StaticQueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in consumer " +
+				               "with parameter: "+eventParameterToStringSerializer(dequeuedEvent->eventParameter)+". Event consumption will not be retried, " +
+				               "since a fall-back queue is not yet implemented.\n" +
+				               "Caused by: "+e.what(),
+				               "threadId",       to_string(threadId),
+				               "consumerThis",   to_string((size_t)consumerThis),
+				               "eventParameter", eventParameterToStringSerializer(dequeuedEvent->eventParameter));
+			} catch (...) {
+				dequeuedEvent->exception = std::current_exception();
+				DUMP_EXCEPTION(runtime_error("Unknown exception in consumer"),
+				               "StaticQueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in consumer " +
+				               "with parameter: "+eventParameterToStringSerializer(dequeuedEvent->eventParameter)+". Event consumption will not be retried, " +
+				               "since a fall-back queue is not yet implemented.\n" +
+				               "Caused by: <<unknown cause>>",
+				               "threadId",       to_string(threadId),
+				               "consumerThis",   to_string((size_t)consumerThis),
+				               "eventParameter", eventParameterToStringSerializer(dequeuedEvent->eventParameter));
+			}
+			if constexpr (_ConsumerTraits::isAnswerfull) {
+				// prepare the exception to be visible when the caller issues an 'waitForAnswer'
+				if (unlikely( (dequeuedEvent->exception != nullptr) && isMutexLocked(dequeuedEvent->answerMutex) )) {
+					// the exception happened before the answer was issued
+					dequeuedEvent->answerObjectReference = nullptr;
+					dequeuedEvent->answerMutex.unlock();
+				}
+				// resume any coroutine awaiting the answer
+				el.completeAnswerfullEvent(*dequeuedEvent);
+			}
+		}
+
+		inline void notifyEventObservers(unsigned int threadId, const _ArgumentType& eventParameter) {
+			for (unsigned int i=0; i<el.nListeners; i++) try {
+				el.listeners[i](eventParameter);
+			} catch (const exception& e) {
+				DUMP_EXCEPTION(runtime_error("Exception in listener: "s + e.what()),
+				               "StaticQueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in event listener #"+to_string(i)+
+				               "with parameter: "+eventParameterToStringSerializer(eventParameter)+".\n" +
+				               "Caused by: "+e.what(),
+				               "threadId",       to_string(threadId),
+				               "eventParameter", eventParameterToStringSerializer(eventParameter));
+			} catch (...) {
+				DUMP_EXCEPTION(runtime_error("Unknown Exception in listener"),
+				               "StaticQueueEventDispatcher for event '"+el.eventName+"', thread #"+to_string(threadId)+": exception in event listener #"+to_string(i)+
+				               "with parameter: "+eventParameterToStringSerializer(eventParameter)+".\n" +
+				               "Caused by: <<unknown cause>>",
+				               "threadId",       to_string(threadId),
+				               "eventParameter", eventParameterToStringSerializer(eventParameter));
+			}
+		}
+
+		void dispatchZeroCopyEventsLoop(int threadId, _ConsumerClass* consumerThis) {
+			QueueElement* dequeuedEvent;
+			int           eventId;
+			while (isActive) {
+				eventId = el.reserveEventForDispatching(dequeuedEvent);
+				if (eventId == -1) {
+					// the link was closed & drained
+					break;
+				}
+				// skipped if cancelled, expired or deferred to the thread holding its key lane
+				el.dispatchDequeuedEvent(*dequeuedEvent, [this, threadId, consumerThis](QueueElement& event) {
+					if constexpr (_ConsumerTraits::isAnswerless || _ConsumerTraits::isAnswerfull) {
+						consumeEvent(threadId, consumerThis, &event);
+					}
+					if constexpr (_NotifyEvents) {
+						notifyEventObservers(threadId, event.eventParameter);
+					}
+				});
+				el.releaseEvent(eventId);
+			}
+		}
+	};
+
+}
+
+#undef likely
+#undef unlikely
+
+#endif /* MUTUA_EVENTS_STATICQUEUEEVENTDISPATCHER_H_ */
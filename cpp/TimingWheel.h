@@ -0,0 +1,329 @@
+#ifndef MUTUA_EVENTS_TIMINGWHEEL_H_
+#define MUTUA_EVENTS_TIMINGWHEEL_H_
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+
+namespace mutua::events {
+
+	/**
+     * TimingWheel.h
+     * =============
+     *
+     * Delayed & periodic events for a 'QueueEventLink' -- retries, timeouts, periodic flushes, ... -- with no thread per timer:
+     *
+     *     TimingWheel retries(retryEvent, chrono::milliseconds(1));
+     *     retries.reportEventAfter(chrono::seconds(2), request);			// one shot
+     *     auto flushTimer = retries.reportPeriodicEvent(chrono::milliseconds(100), flushRequest);
+     *     retries.cancelTimer(flushTimer);
+     *
+     * Pending timers live in a hierarchical timing wheel: _NLevels wheels of 2^_Log2_WheelSlots slots each, where level 'l' slots
+     * span (2^_Log2_WheelSlots)^l ticks. Scheduling & cancelling are O(1) (doubly linked slot lists, over a recycled pool of timers);
+     * a single thread advances the wheel, tick by tick, reporting the due timers' parameters into the link's normal ring -- so they
+     * get dispatched as any other event -- and cascading the timers of a higher level slot into the lower levels whenever a lower
+     * level wheel completes a turn. Timers due further than the highest level spans wait on its last slot, being cascaded again.
+     *
+     * Timers fire on the first tick not before their due time: the tick duration is the timers' resolution.
+     *
+    */
+	template <class _QueueEventLink, uint_fast8_t _Log2_WheelSlots = 8, unsigned int _NLevels = 4>
+	class TimingWheel {
+
+	public:
+
+		// types from _QueueEventLink:
+		typedef decltype(_QueueEventLink::QueueElement::eventParameter) _ArgumentType;
+
+		typedef unsigned long long TimerId;		// generation << 32 | timer index
+
+		constexpr static unsigned int       wheelSlots        = (unsigned int) 1 << (unsigned int) _Log2_WheelSlots;
+		constexpr static unsigned int       wheelSlotsModulus = wheelSlots - 1;
+		constexpr static unsigned long long maxDeltaTicks     = (1ull << (_Log2_WheelSlots * _NLevels)) - 1;
+
+		struct Timer {
+			_ArgumentType      eventParameter;
+			unsigned long long dueTick;
+			unsigned long long periodTicks;		// 0 for one shot timers
+			unsigned int       generation;		// tells reuses of the same pool position apart -- see 'TimerId'
+			int                next;			// slot list links -- 'next' is also used by the free list
+			int                prev;
+			int*               slot;			// head of the list the timer is in -- or nullptr when free
+		};
+
+
+	private:
+
+		_QueueEventLink&        el;
+		unsigned long long      tickNS;
+		chrono::steady_clock::time_point startTime;
+
+		mutex                   wheelGuard;
+		condition_variable      wheelAdvancer;
+		vector<Timer>           timers;
+		int                     freeTimers;
+		int                     slots[_NLevels][wheelSlots];
+		unsigned long long      currentTick;		// ticks already processed
+		unsigned int            nPendingTimers;
+		vector<_ArgumentType>   dueParameters;		// reused, so expirations don't allocate
+		bool                    isStopping;
+		thread                  wheelThread;
+
+
+	public:
+
+		template <typename _Rep = long long, typename _Period = std::milli>
+		TimingWheel(_QueueEventLink& el, chrono::duration<_Rep, _Period> tickDuration = chrono::milliseconds(1))
+				: el             (el)
+				, tickNS         (chrono::duration_cast<chrono::nanoseconds>(tickDuration).count())
+				, startTime      (chrono::steady_clock::now())
+				, freeTimers     (-1)
+				, currentTick    (0)
+				, nPendingTimers (0)
+				, isStopping     (false) {
+			if (tickNS == 0) {
+				THROW_EXCEPTION(invalid_argument, "TimingWheel for event '"+el.eventName+"': the tick duration must be at least 1ns");
+			}
+			for (auto& level : slots) {
+				for (int& slot : level) {
+					slot = -1;
+				}
+			}
+			wheelThread = thread(&TimingWheel::wheelLoop, this);
+		}
+
+		~TimingWheel() {
+			stop();
+		}
+
+		/** Stops the wheel, dropping any pending timers */
+		void stop() {
+			{
+				scoped_lock<mutex> lock(wheelGuard);
+				isStopping = true;
+			}
+			wheelAdvancer.notify_all();
+			if (wheelThread.joinable()) {
+				wheelThread.join();
+			}
+		}
+
+		/** Reports an answerless event for 'eventParameter' at 'dueTime' */
+		TimerId reportEventAt(chrono::steady_clock::time_point dueTime, const _ArgumentType& eventParameter) {
+			return schedule(dueTime, 0, eventParameter);
+		}
+
+		/** Reports an answerless event for 'eventParameter' after 'delay' */
+		template <typename _Rep, typename _Period>
+		TimerId reportEventAfter(chrono::duration<_Rep, _Period> delay, const _ArgumentType& eventParameter) {
+			return schedule(chrono::steady_clock::now() + delay, 0, eventParameter);
+		}
+
+		/** Reports an answerless event for 'eventParameter' every 'period', starting one 'period' from now, until cancelled */
+		template <typename _Rep, typename _Period>
+		TimerId reportPeriodicEvent(chrono::duration<_Rep, _Period> period, const _ArgumentType& eventParameter) {
+			unsigned long long periodTicks = (chrono::duration_cast<chrono::nanoseconds>(period).count() + tickNS - 1) / tickNS;
+			return schedule(chrono::steady_clock::now() + period, periodTicks == 0 ? 1 : periodTicks, eventParameter);
+		}
+
+		/** Returns true if the timer was still pending -- one shot timers that already fired and unknown ids are ignored */
+		bool cancelTimer(TimerId timerId) {
+			unsigned int index      = timerId & 0xFFFFFFFFull;
+			unsigned int generation = timerId >> 32;
+			scoped_lock<mutex> lock(wheelGuard);
+			if ( (index >= timers.size()) || (timers[index].generation != generation) || (timers[index].slot == nullptr) ) {
+				return false;
+			}
+			unlink(index);
+			freeTimer(index);
+			return true;
+		}
+
+		unsigned int getNumberOfPendingTimers() {
+			scoped_lock<mutex> lock(wheelGuard);
+			return nPendingTimers;
+		}
+
+	private:
+
+		TimerId schedule(chrono::steady_clock::time_point dueTime, unsigned long long periodTicks, const _ArgumentType& eventParameter) {
+			long long dueNS = chrono::duration_cast<chrono::nanoseconds>(dueTime - startTime).count();
+			unsigned long long dueTick = dueNS <= 0 ? 0 : (dueNS + tickNS - 1) / tickNS;
+			TimerId timerId;
+			{
+				scoped_lock<mutex> lock(wheelGuard);
+				if (isStopping) {
+					THROW_EXCEPTION(runtime_error, "TimingWheel for event '"+el.eventName+"': can't schedule events on a stopped wheel");
+				}
+				if (nPendingTimers == 0) {
+					// an empty wheel may skip the ticks it slept through
+					currentTick = max(currentTick, getCurrentTick());
+				}
+				unsigned int index = allocateTimer();
+				Timer& timer = timers[index];
+				timer.eventParameter = eventParameter;
+				timer.dueTick        = dueTick;
+				timer.periodTicks    = periodTicks;
+				link(index);
+				nPendingTimers++;
+				timerId = ((TimerId) timer.generation << 32) | index;
+			}
+			wheelAdvancer.notify_one();
+			return timerId;
+		}
+
+		inline unsigned long long getCurrentTick() {
+			return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count() / tickNS;
+		}
+
+		/** Takes a timer from the free list -- or grows the pool. To be called with 'wheelGuard' locked */
+		inline unsigned int allocateTimer() {
+			if (freeTimers != -1) {
+				unsigned int index = freeTimers;
+				freeTimers = timers[index].next;
+				return index;
+			}
+			timers.push_back({});
+			timers.back().generation = 0;
+			timers.back().slot       = nullptr;
+			return timers.size()-1;
+		}
+
+		/** To be called with 'wheelGuard' locked, after the timer got unlinked */
+		inline void freeTimer(unsigned int index) {
+			timers[index].generation++;
+			timers[index].next = freeTimers;
+			freeTimers = index;
+			nPendingTimers--;
+		}
+
+		/** Places the timer on the slot of the lowest level able to span its due tick. To be called with 'wheelGuard' locked.
+		 *  When 'isCascading', timers due on the current tick go to the current level 0 slot, which 'advance()' processes next */
+		inline void link(unsigned int index, bool isCascading = false) {
+			Timer& timer = timers[index];
+			// past due timers fire on the next tick
+			unsigned long long delta = timer.dueTick > currentTick ? timer.dueTick - currentTick : (isCascading ? 0 : 1);
+			unsigned long long bucketTick = currentTick + (delta > maxDeltaTicks ? maxDeltaTicks : delta);
+			unsigned int level = 0;
+			while ( (level < _NLevels-1) && ((bucketTick - currentTick) >> (_Log2_WheelSlots * (level+1))) != 0 ) {
+				level++;
+			}
+			int& slot = slots[level][(bucketTick >> (_Log2_WheelSlots * level)) & wheelSlotsModulus];
+			timer.slot = &slot;
+			timer.prev = -1;
+			timer.next = slot;
+			if (slot != -1) {
+				timers[slot].prev = index;
+			}
+			slot = index;
+		}
+
+		/** To be called with 'wheelGuard' locked */
+		inline void unlink(unsigned int index) {
+			Timer& timer = timers[index];
+			if (timer.prev != -1) {
+				timers[timer.prev].next = timer.next;
+			} else {
+				*timer.slot = timer.next;
+			}
+			if (timer.next != -1) {
+				timers[timer.next].prev = timer.prev;
+			}
+			timer.slot = nullptr;
+		}
+
+		/** Re-links all timers of a higher level slot, as the lower level wheels completed a turn. To be called with 'wheelGuard' locked */
+		inline void cascade(unsigned int level) {
+			int& slot = slots[level][(currentTick >> (_Log2_WheelSlots * level)) & wheelSlotsModulus];
+			int index = slot;
+			slot = -1;
+			while (index != -1) {
+				int next = timers[index].next;
+				link(index, true);
+				index = next;
+			}
+		}
+
+		/** Processes the next tick, moving the due timers' parameters into 'dueParameters'. To be called with 'wheelGuard' locked */
+		inline void advance() {
+			currentTick++;
+			for (unsigned int level=1; level<_NLevels; level++) {
+				if ( (currentTick & ((1ull << (_Log2_WheelSlots * level)) - 1)) != 0 ) {
+					break;
+				}
+				cascade(level);
+			}
+			int& slot = slots[0][currentTick & wheelSlotsModulus];
+			int index = slot;
+			slot = -1;
+			while (index != -1) {
+				Timer& timer = timers[index];
+				int next = timer.next;
+				timer.slot = nullptr;
+				dueParameters.push_back(timer.eventParameter);
+				if (timer.periodTicks > 0) {
+					timer.dueTick += timer.periodTicks;
+					link(index);
+				} else {
+					freeTimer(index);
+				}
+				index = next;
+			}
+		}
+
+		void wheelLoop() {
+			unique_lock<mutex> lock(wheelGuard);
+			while (!isStopping) {
+				if (nPendingTimers == 0) {
+					wheelAdvancer.wait(lock);
+					continue;
+				}
+				unsigned long long nowTick = getCurrentTick();
+				if (currentTick >= nowTick) {
+					wheelAdvancer.wait_until(lock, startTime + chrono::nanoseconds((currentTick+1) * tickNS));
+					continue;
+				}
+				while ( (currentTick < nowTick) && (nPendingTimers > 0) ) {
+					advance();
+				}
+				if (dueParameters.size() == 0) {
+					continue;
+				}
+				// report without holding the wheel, as the link may be full
+				vector<_ArgumentType> reportingParameters;
+				reportingParameters.swap(dueParameters);
+				lock.unlock();
+				reportDueEvents(reportingParameters);
+				reportingParameters.clear();
+				lock.lock();
+				if (dueParameters.size() == 0) {
+					dueParameters.swap(reportingParameters);
+				}
+			}
+		}
+
+		inline void reportDueEvents(vector<_ArgumentType>& parameters) {
+			_ArgumentType* reservedParameterReference;
+			for (_ArgumentType& eventParameter : parameters) try {
+				int eventId = el.reserveEventForReporting(reservedParameterReference);
+				*reservedParameterReference = eventParameter;
+				el.reportReservedEvent(eventId);
+			} catch (const exception& e) {
+				DUMP_EXCEPTION(runtime_error("Exception reporting a timed event: "s + e.what()),
+				               "TimingWheel for event '"+el.eventName+"': a due event could not be reported -- dropping it.\n" +
+				               "Caused by: "+e.what());
+			}
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_TIMINGWHEEL_H_ */
@@ -0,0 +1,345 @@
+#ifndef MUTUA_EVENTS_TOPICBUS_H_
+#define MUTUA_EVENTS_TOPICBUS_H_
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+#include <BetterExceptions.h>
+//using namespace mutua::cpputils;
+
+
+namespace mutua::events {
+
+	/**
+     * TopicBus.h
+     * ==========
+     *
+     * Publish / subscribe by hierarchical topic, over 'QueueEventLink's: subscribers register, at any time, their links (rings) with
+     * patterns of '.' separated segments, where '*' matches exactly one segment and a trailing '#' matches zero or more of them:
+     *
+     *     TopicBus<OrdersLink> bus;
+     *     bus.subscribe("orders.eu.*", euOrdersLink);
+     *     bus.subscribe("orders.#",    auditLink);
+     *     bus.publish("orders.eu.fr", order);		// reported on both links
+     *
+     * Subscriptions are compiled into an immutable routing table -- a trie of segments whose nodes hold bitmaps of the matching
+     * subscribers -- so publishing costs a trie walk (OR-ing the bitmaps, which also removes duplicates) plus the fan-out into the
+     * subscribers' rings. Subscription changes build a new table, copy-on-write, and swap it in: the publish path never takes locks.
+     * Retired tables are reclaimed RCU style -- publishers announce themselves on one of two counters, according to the current
+     * epoch, and subscription changes flip the epoch & wait for the old counter to drain before deleting the previous table.
+     * Publishers only stay on the epoch while routing: before reporting, they pin each matched subscriber (on its own counter), so
+     * a publisher blocked on a subscriber's link holds back the unsubscription of that subscriber alone.
+     *
+     * Reporting blocks while a subscriber's link is full -- so slow subscribers hold the publishers back. Subscribers whose links
+     * fail the reporting (because they were closed or by their admission control) are skipped and counted -- see 'getNumberOfFailedDeliveries()'.
+     *
+    */
+	template <class _QueueEventLink>
+	class TopicBus {
+
+	public:
+
+		// types from _QueueEventLink:
+		typedef decltype(_QueueEventLink::QueueElement::eventParameter) _ArgumentType;
+
+		typedef unsigned int SubscriptionId;
+
+	private:
+
+		struct RoutingNode {
+			map<string, unsigned int, less<>> children;			// by segment
+			int                               anySegmentChild;		// the '*' child -- or -1
+			vector<uint64_t>                  exactSubscribers;		// subscribers of patterns ending here
+			vector<uint64_t>                  trailingSubscribers;	// subscribers of patterns ending with a '#' here
+		};
+
+		struct Subscriber {
+			_QueueEventLink*     subscriberLink;
+			atomic<unsigned int> nPins;				// publishers that may still report on 'subscriberLink'
+		};
+
+		struct RoutingTable {
+			vector<Subscriber*>      subscribers;	// bit 'i' of the bitmaps stands for 'subscribers[i]'
+			vector<RoutingNode>      nodes;			// 'nodes[0]' is the root
+			unsigned int             nBitmapWords;
+		};
+
+		struct Subscription {
+			string           pattern;
+			_QueueEventLink* subscriberLink;		// nullptr when unsubscribed
+		};
+
+		atomic<RoutingTable*>            routingTable;
+		alignas(64) atomic<unsigned int> epoch;
+		alignas(64) atomic<unsigned int> nPublishers[2];	// publishers that entered on an even / odd epoch
+		mutex                            subscriptionsGuard;	// taken by subscription changes only
+		vector<Subscription>             subscriptions;
+		map<_QueueEventLink*, Subscriber*> subscribers;		// of the current subscriptions, by link
+		atomic<unsigned long long>       nFailedDeliveries;
+
+		static constexpr unsigned int inlineBitmapWords = 4;	// subscribers routed without heap allocations
+
+
+	public:
+
+		TopicBus()
+				: routingTable (nullptr)
+				, epoch        (0)
+				, nPublishers  {0, 0}
+				, nFailedDeliveries (0) {
+			routingTable.store(compileRoutingTable(), memory_order_release);
+		}
+
+		~TopicBus() {
+			delete routingTable.load(memory_order_acquire);
+			for (auto& [subscriberLink, subscriber] : subscribers) {
+				delete subscriber;
+			}
+		}
+
+		/** Have events published on topics matching 'pattern' reported on 'subscriberLink' */
+		SubscriptionId subscribe(const string& pattern, _QueueEventLink& subscriberLink) {
+			checkPattern(pattern);
+			scoped_lock<mutex> lock(subscriptionsGuard);
+			if (subscribers.find(&subscriberLink) == subscribers.end()) {
+				subscribers.emplace(&subscriberLink, new Subscriber{&subscriberLink, 0});
+			}
+			subscriptions.push_back({pattern, &subscriberLink});
+			swapRoutingTable();
+			return subscriptions.size()-1;
+		}
+
+		/** Returns false if 'subscriptionId' was already unsubscribed (or never existed). Once this returns, no events are reported
+		 *  on the link of its last subscription anymore -- so this waits for publishers blocked on it: close the link first (stopping
+		 *  its dispatcher, for instance) if it may be full */
+		bool unsubscribe(SubscriptionId subscriptionId) {
+			Subscriber* retiredSubscriber = nullptr;
+			{
+				scoped_lock<mutex> lock(subscriptionsGuard);
+				if ( (subscriptionId >= subscriptions.size()) || (subscriptions[subscriptionId].subscriberLink == nullptr) ) {
+					return false;
+				}
+				_QueueEventLink* subscriberLink = subscriptions[subscriptionId].subscriberLink;
+				subscriptions[subscriptionId].subscriberLink = nullptr;
+				swapRoutingTable();
+				bool isStillSubscribed = false;
+				for (const Subscription& subscription : subscriptions) {
+					isStillSubscribed |= subscription.subscriberLink == subscriberLink;
+				}
+				if (!isStillSubscribed) {
+					retiredSubscriber = subscribers[subscriberLink];
+					subscribers.erase(subscriberLink);
+				}
+			}
+			if (retiredSubscriber != nullptr) {
+				// no longer routed to: wait for the publishers that pinned it
+				while (retiredSubscriber->nPins.load(memory_order_acquire) != 0) {
+					this_thread::yield();
+				}
+				delete retiredSubscriber;
+			}
+			return true;
+		}
+
+		/** Number of times a matched subscriber was skipped, since reporting on its link failed */
+		unsigned long long getNumberOfFailedDeliveries() {
+			return nFailedDeliveries.load(memory_order_relaxed);
+		}
+
+		/** Reports an answerless event for 'eventParameter' on the link of each subscriber (once, even if several of its patterns match)
+		 *  of 'topic' -- which must have no wildcards. Returns the number of subscribers reached */
+		unsigned int publish(string_view topic, const _ArgumentType& eventParameter) {
+			// announce this publisher for the current epoch
+			unsigned int publisherEpoch;
+			while (true) {
+				publisherEpoch = epoch.load(memory_order_seq_cst);
+				nPublishers[publisherEpoch & 1].fetch_add(1, memory_order_seq_cst);
+				if (epoch.load(memory_order_seq_cst) == publisherEpoch) {
+					break;
+				}
+				nPublishers[publisherEpoch & 1].fetch_sub(1, memory_order_release);
+			}
+			const RoutingTable& table = *routingTable.load(memory_order_seq_cst);
+
+			// route & pin the matched subscribers -- local buffers, as consumers running inline may publish as well
+			uint64_t         inlineBitmap[inlineBitmapWords];
+			vector<uint64_t> heapBitmap;
+			uint64_t*        matchedSubscribers = inlineBitmap;
+			if (table.nBitmapWords > inlineBitmapWords) {
+				heapBitmap.resize(table.nBitmapWords);
+				matchedSubscribers = heapBitmap.data();
+			}
+			fill(matchedSubscribers, matchedSubscribers + table.nBitmapWords, 0);
+			route(table, 0, topic, matchedSubscribers);
+			Subscriber*         inlinePins[inlineBitmapWords * 64];
+			vector<Subscriber*> heapPins;
+			Subscriber**        pinnedSubscribers = inlinePins;
+			if (table.nBitmapWords > inlineBitmapWords) {
+				heapPins.resize(table.nBitmapWords * 64);
+				pinnedSubscribers = heapPins.data();
+			}
+			unsigned int nPinnedSubscribers = 0;
+			for (unsigned int word=0; word<table.nBitmapWords; word++) {
+				for (uint64_t bits = matchedSubscribers[word]; bits != 0; bits &= bits-1) {
+					Subscriber* subscriber = table.subscribers[word*64 + __builtin_ctzll(bits)];
+					subscriber->nPins.fetch_add(1, memory_order_relaxed);
+					pinnedSubscribers[nPinnedSubscribers++] = subscriber;
+				}
+			}
+			// the table is no longer needed: don't hold subscription changes back while reporting
+			nPublishers[publisherEpoch & 1].fetch_sub(1, memory_order_release);
+
+			unsigned int nReachedSubscribers = 0;
+			for (unsigned int i=0; i<nPinnedSubscribers; i++) {
+				_QueueEventLink& subscriberLink = *pinnedSubscribers[i]->subscriberLink;
+				try {
+					_ArgumentType* reservedParameterReference;
+					int eventId = subscriberLink.reserveEventForReporting(reservedParameterReference);
+					*reservedParameterReference = eventParameter;
+					subscriberLink.reportReservedEvent(eventId);
+					nReachedSubscribers++;
+				} catch (...) {
+					// closed or rejecting: the other subscribers must still get the event
+					nFailedDeliveries.fetch_add(1, memory_order_relaxed);
+				}
+				pinnedSubscribers[i]->nPins.fetch_sub(1, memory_order_release);
+			}
+			return nReachedSubscribers;
+		}
+
+	private:
+
+		void checkPattern(const string& pattern) {
+			size_t hashPosition = pattern.find('#');
+			if ( pattern.empty() || ( (hashPosition != string::npos) && (hashPosition != pattern.size()-1) ) ||
+			     ( (hashPosition != string::npos) && (hashPosition > 0) && (pattern[hashPosition-1] != '.') ) ) {
+				THROW_EXCEPTION(invalid_argument, "TopicBus: invalid subscription pattern '"+pattern+"' -- '#' may only be the last segment");
+			}
+		}
+
+		/** Builds a new routing table, publishes it and reclaims the previous one, as soon as no publisher may be using it.
+		 *  To be called with 'subscriptionsGuard' locked */
+		void swapRoutingTable() {
+			RoutingTable* previousTable = routingTable.exchange(compileRoutingTable(), memory_order_seq_cst);
+			unsigned int  previousEpoch = epoch.fetch_add(1, memory_order_seq_cst);
+			while (nPublishers[previousEpoch & 1].load(memory_order_acquire) != 0) {
+				this_thread::yield();
+			}
+			delete previousTable;
+		}
+
+		/** To be called with 'subscriptionsGuard' locked (or on construction) */
+		RoutingTable* compileRoutingTable() {
+			RoutingTable* table = new RoutingTable();
+			for (const Subscription& subscription : subscriptions) {
+				if (subscription.subscriberLink != nullptr) {
+					bool isKnown = false;
+					for (Subscriber* subscriber : table->subscribers) {
+						isKnown |= subscriber->subscriberLink == subscription.subscriberLink;
+					}
+					if (!isKnown) {
+						table->subscribers.push_back(subscribers[subscription.subscriberLink]);
+					}
+				}
+			}
+			table->nBitmapWords = (table->subscribers.size() + 63) / 64;
+			table->nodes.push_back(newNode(*table));
+			for (const Subscription& subscription : subscriptions) {
+				if (subscription.subscriberLink == nullptr) {
+					continue;
+				}
+				unsigned int subscriberBit = 0;
+				while (table->subscribers[subscriberBit]->subscriberLink != subscription.subscriberLink) {
+					subscriberBit++;
+				}
+				unsigned int nodeIndex = 0;
+				string_view  remaining = subscription.pattern;
+				while (true) {
+					size_t      dotPosition = remaining.find('.');
+					string_view segment     = remaining.substr(0, dotPosition);
+					if (segment == "#") {
+						setBit(table->nodes[nodeIndex].trailingSubscribers, subscriberBit);
+						break;
+					}
+					nodeIndex = getOrCreateChild(*table, nodeIndex, segment);
+					if (dotPosition == string_view::npos) {
+						setBit(table->nodes[nodeIndex].exactSubscribers, subscriberBit);
+						break;
+					}
+					remaining = remaining.substr(dotPosition+1);
+				}
+			}
+			return table;
+		}
+
+		static RoutingNode newNode(const RoutingTable& table) {
+			return {{}, -1, vector<uint64_t>(table.nBitmapWords, 0), vector<uint64_t>(table.nBitmapWords, 0)};
+		}
+
+		static unsigned int getOrCreateChild(RoutingTable& table, unsigned int nodeIndex, string_view segment) {
+			if (segment == "*") {
+				if (table.nodes[nodeIndex].anySegmentChild == -1) {
+					table.nodes.push_back(newNode(table));
+					table.nodes[nodeIndex].anySegmentChild = table.nodes.size()-1;
+				}
+				return table.nodes[nodeIndex].anySegmentChild;
+			}
+			auto child = table.nodes[nodeIndex].children.find(segment);
+			if (child != table.nodes[nodeIndex].children.end()) {
+				return child->second;
+			}
+			table.nodes.push_back(newNode(table));
+			unsigned int childIndex = table.nodes.size()-1;
+			table.nodes[nodeIndex].children.emplace(string(segment), childIndex);
+			return childIndex;
+		}
+
+		static inline void setBit(vector<uint64_t>& bitmap, unsigned int bit) {
+			bitmap[bit / 64] |= 1ull << (bit % 64);
+		}
+
+		static inline void orBitmap(uint64_t* destination, const vector<uint64_t>& source) {
+			for (unsigned int word=0; word<source.size(); word++) {
+				destination[word] |= source[word];
+			}
+		}
+
+		/** Walks the trie from 'nodeIndex' along the 'remaining' segments of the topic, OR-ing the matching subscribers into 'matched' */
+		static void route(const RoutingTable& table, unsigned int nodeIndex, string_view remaining, uint64_t* matched) {
+			const RoutingNode& node = table.nodes[nodeIndex];
+			orBitmap(matched, node.trailingSubscribers);
+			size_t      dotPosition = remaining.find('.');
+			string_view segment     = remaining.substr(0, dotPosition);
+			string_view rest        = dotPosition == string_view::npos ? string_view() : remaining.substr(dotPosition+1);
+			bool        isLast      = dotPosition == string_view::npos;
+			auto child = node.children.find(segment);
+			if (child != node.children.end()) {
+				if (isLast) {
+					orBitmap(matched, table.nodes[child->second].exactSubscribers);
+					orBitmap(matched, table.nodes[child->second].trailingSubscribers);
+				} else {
+					route(table, child->second, rest, matched);
+				}
+			}
+			if (node.anySegmentChild != -1) {
+				if (isLast) {
+					orBitmap(matched, table.nodes[node.anySegmentChild].exactSubscribers);
+					orBitmap(matched, table.nodes[node.anySegmentChild].trailingSubscribers);
+				} else {
+					route(table, node.anySegmentChild, rest, matched);
+				}
+			}
+		}
+
+	};
+}
+
+#endif /* MUTUA_EVENTS_TOPICBUS_H_ */
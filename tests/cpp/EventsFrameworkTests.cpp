@@ -7,6 +7,7 @@
 #include <queue>
 #include <thread>
 #include <initializer_list>
+#include <coroutine>
 using namespace std;
 
 #include <boost/test/unit_test.hpp>
@@ -19,36 +20,24 @@ using namespace std;
 #include <TimeMeasurements.h>
 using namespace mutua::cpputils;
 
+#include <EventDelegate.h>
+#include <AnswerGroups.h>
+#include <AnswerStream.h>
+#include <AnswerCache.h>
+#include <MulticastDispatcher.h>
+#include <LinkConnector.h>
+#include <StateChannel.h>
+#include <TimingWheel.h>
+#include <MultiEventLink.h>
+#include <EventRegistry.h>
+#include <TopicBus.h>
 #include <QueueEventLink.h>
 #include <QueueEventDispatcher.h>
+#include <StaticQueueEventDispatcher.h>
 //using namespace mutua::events;
 
 
-template<typename _Argument>
-struct EventDefinition {
-	void(&&procedureReference)(_Argument);
-	EventDefinition(void(&&procedureReference)(_Argument))
-		: procedureReference(procedureReference) {}
-};
-
 enum class MyEvents {EventA, EventB, EventC, last=EventC};
-template <typename _Argument, class E, class = std::enable_if_t<std::is_enum<E>{}>>
-class EventFramework {
-public:
-	EventFramework(const EventDefinition<_Argument> (&eventHandlers)[((int)(E::last)) + 1]) {
-		int eventsEnumerationLength = ((int)(E::last)) + 1;
-		cerr << "Now at EventFramework!" << endl;
-		cerr << "length of E:   " << eventsEnumerationLength << endl;
-		cerr << "events.size(): " << sizeof(eventHandlers) / sizeof(eventHandlers[0]) << endl;
-//		for (int i=0; i<events.size(); i++) {
-//			int v = (int)static_cast<E>(static_cast<std::underlying_type_t<E>>(events[i]));
-//			cerr << "events[" << i << "] = '" << v << "'" << endl;
-//		}
-	}
-};
-//E &operator ++ (E &e) {
-//    return e = static_cast<E>(static_cast<std::underlying_type_t<E>>(e) + 1);
-//}
 
 
 template <typename _QueueElement, typename _QueueSlotsType = uint_fast8_t>
@@ -567,12 +556,7 @@ void _myShits(const double& p, int* answer, std::mutex& answerMutex) { cerr << "
 void _myListener(const double& p) { cerr << "(listening p=" << p << "); ";}
 void _myShits(const float& p)  { cerr << "my float*  shits with p is " << p << endl;}
 BOOST_AUTO_TEST_CASE(apiUsageTest) {
-/*	EventFramework<int, MyEvents> myab({
-		[(int)MyEvents::EventA]=EventDefinition<int>(_myIShits),
-		[(int)MyEvents::EventB]=EventDefinition<int>(_myIShits),
-		[(int)MyEvents::EventC]=EventDefinition<int>(_myIShits)});
-
-	DirectEventLink<void, int,   10>    INT_SHITS("Integral shits");
+/*	DirectEventLink<void, int,   10>    INT_SHITS("Integral shits");
 	INT_SHITS.setAnswerlessConsumer(_myShits);
 	DirectEventLink<int, double, 10> DOUBLE_SHITS("Double shits");
 	DOUBLE_SHITS.setAnswerfullConsumer(_myShits);
@@ -713,6 +697,36 @@ struct QueueEventLinkSuiteObjects {
     	notifyedEvents[n]+=512;
 	}
 
+	/** The simplest coroutine return type -- starts right away & is self destroyed when done */
+	struct FireAndForget {
+		struct promise_type {
+			FireAndForget       get_return_object()           { return {}; }
+			std::suspend_never  initial_suspend()   noexcept  { return {}; }
+			std::suspend_never  final_suspend()     noexcept  { return {}; }
+			void                return_void()                 {}
+			void                unhandled_exception()         { std::terminate(); }
+		};
+	};
+
+	template <typename _QueueEventLink>
+	static FireAndForget awaitAnswer(_QueueEventLink& link, unsigned int n, atomic_uint* answers) {
+		answers[n] = co_await link.reportAndAwait(n);
+	}
+
+	template <typename _QueueEventLink>
+	static FireAndForget awaitFailedAnswer(_QueueEventLink& link, unsigned int n, atomic_bool* hasThrown) {
+		unsigned int  answer;
+		unsigned int* reservedParameterReference;
+		int eventId = link.reserveEventForReporting(reservedParameterReference, &answer);
+		*reservedParameterReference = n;
+		link.reportReservedEvent(eventId);
+		try {
+			co_await link.answer(eventId);
+		} catch (const runtime_error& e) {
+			*hasThrown = true;
+		}
+	}
+
 	void checkAllElements(atomic_uint* consumerArray, atomic_uint* listenerArray, unsigned int expectedValue) {
 		for (int i=0; i<65536; i++) {
 			if (consumerArray[i] != expectedValue) {
@@ -957,7 +971,7 @@ BOOST_AUTO_TEST_CASE(waitForAConsumableEvent) {
 
 	decltype(qShits)::QueueElement* dequeuedEvent;
 	unsigned int dispatchedEventId = qShits.reserveEventForDispatching(dequeuedEvent);
-	qShits.answerlessConsumerProcedureReference(qShits.answerlessConsumerThese[0], dequeuedEvent->eventParameter);
+	qShits.answerlessConsumers[0](dequeuedEvent->eventParameter);
 	qShits.releaseEvent(dispatchedEventId);
 
 
@@ -1018,6 +1032,1637 @@ BOOST_AUTO_TEST_CASE(busyEventGeneration) {
 	HEAP_TRACE("busyEventGeneration", output);
 }
 
+BOOST_AUTO_TEST_CASE(staticDispatcherEvents) {
+	HEAP_MARK();
+
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("staticDispatcherEvents tests");
+	myEvent.addListener(&QueueEventLinkSuiteObjects::_eventListener1, (QueueEventLinkSuiteObjects*)this);
+	mutua::events::StaticQueueEventDispatcher<decltype(myEvent), &QueueEventLinkSuiteObjects::_answerlessEventConsumer, true>
+		myDispatcher(myEvent, {this, this, this, this});
+
+	constexpr int threadsLength = 4;
+	thread threads[threadsLength];
+	for (int n=0; n<threadsLength; n++) {
+		threads[n] = thread([&] {
+			unsigned int* reservedParameterReference;
+			for (unsigned int i=0; i<65536; i++) {
+				unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+				*reservedParameterReference = i;
+				myEvent.reportReservedEvent(eventId);
+			}
+		});
+	}
+
+	// wait for producers
+	for (int n=0; n<threadsLength; n++) {
+		threads[n].join();
+	}
+
+	// wait until all queue is processed
+	myDispatcher.stopWhenEmpty();
+
+	checkAllElements(answerlessConsumedEvents, notifyedEvents, threadsLength);
+
+	HEAP_TRACE("staticDispatcherEvents", output);
+}
+
+BOOST_AUTO_TEST_CASE(lambdaConsumersAndListeners) {
+	HEAP_MARK();
+
+	// consumers & listeners given as lambdas -- one consumer delegate per dispatcher thread
+	auto consumer = [this](const unsigned int& n) { answerlessConsumedEvents[n]++; };
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("lambdaConsumersAndListeners tests");
+	myEvent.setAnswerlessConsumer({consumer, consumer, consumer, consumer});
+	decltype(myEvent)::Listener listener2 = [this](const unsigned int& n) { notifyedEvents[n]+=2; };
+	myEvent.addListener([this](const unsigned int& n) { notifyedEvents[n]+=1; });
+	myEvent.addListener(listener2);
+	myEvent.addListener(&QueueEventLinkSuiteObjects::_eventListener4, (QueueEventLinkSuiteObjects*)this);
+	BOOST_TEST(myEvent.removeListener(listener2),                                                               "lambda listener removal");
+	BOOST_TEST(myEvent.removeListener(&QueueEventLinkSuiteObjects::_eventListener4, (QueueEventLinkSuiteObjects*)this), "method listener removal");
+	BOOST_TEST(!myEvent.removeListener(listener2),                                                              "removal of an already removed listener");
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 4, 0, true, true, true, false, false);
+
+	unsigned int* reservedParameterReference;
+	for (unsigned int i=0; i<65536; i++) {
+		unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+
+	// wait until all queue is processed
+	myDispatcher.stopWhenEmpty();
+
+	checkAllElements(answerlessConsumedEvents, notifyedEvents, 1);
+
+	HEAP_TRACE("lambdaConsumersAndListeners", output);
+}
+
+BOOST_AUTO_TEST_CASE(autoscalingDispatcher) {
+	HEAP_MARK();
+
+	// consumers blocked off-CPU (as if doing I/O) should make the dispatcher grow up to 'maxThreads' while there is a backlog...
+	auto consumer = [this](const unsigned int& n) { this_thread::sleep_for(chrono::milliseconds(1)); answerlessConsumedEvents[n]++; };
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("autoscalingDispatcher tests");
+	myEvent.setAnswerlessConsumer({consumer, consumer, consumer, consumer});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 4, 0, true, false, true, false, false);
+	BOOST_TEST(myDispatcher.getNumberOfActiveThreads() == 1, "autoscaling dispatchers must start with 'minThreads' active threads");
+
+	unsigned int* reservedParameterReference;
+	for (unsigned int i=0; i<800; i++) {
+		unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+	int maxActiveThreads = 0;
+	while (myEvent.getQueueLength() > 0) {
+		maxActiveThreads = max(maxActiveThreads, myDispatcher.getNumberOfActiveThreads());
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	output("max active threads: " + to_string(maxActiveThreads) + "\n");
+	BOOST_TEST(maxActiveThreads == 4, "the backlog of blocked consumers should have taken the dispatcher to 'maxThreads'");
+
+	// ... and shrink back to 'minThreads' once idle
+	for (int i=0; (i<2000) && (myDispatcher.getNumberOfActiveThreads() > 1); i++) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	BOOST_TEST(myDispatcher.getNumberOfActiveThreads() == 1, "idle threads should have been parked");
+
+	// parked threads must not prevent the drain
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	for (int i=0; i<800; i++) {
+		BOOST_REQUIRE_MESSAGE(answerlessConsumedEvents[i] == 1, "answerlessConsumedEvents["+to_string(i)+"] == 1 failed");
+	}
+
+	HEAP_TRACE("autoscalingDispatcher", output);
+}
+
+BOOST_AUTO_TEST_CASE(inlineWhenIdle) {
+	HEAP_MARK();
+
+	struct {
+		thread::id   consumerThreadIds[2];
+		atomic_int   nConcurrentConsumers;
+		atomic_int   maxConcurrentConsumers;
+		mutex        consumerGate;
+	} c;
+	c.nConcurrentConsumers   = 0;
+	c.maxConcurrentConsumers = 0;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("inlineWhenIdle tests");
+	myEvent.setAnswerlessConsumer({[this, &c](const unsigned int& n) {
+		int concurrentConsumers = ++c.nConcurrentConsumers;
+		c.maxConcurrentConsumers = max(c.maxConcurrentConsumers.load(), concurrentConsumers);
+		c.consumerThreadIds[n] = this_thread::get_id();
+		if (n == 0) {
+			c.consumerGate.lock();
+			c.consumerGate.unlock();
+		}
+		answerlessConsumedEvents[n]++;
+		c.nConcurrentConsumers--;
+	}});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, true, false, false);
+	myDispatcher.enableInlineWhenIdle();
+	unsigned int* reservedParameterReference;
+
+	// an event reported on an idle link is consumed by the producer thread, which waits on 'consumerGate' -- holding the only consumer instance
+	c.consumerGate.lock();
+	thread producer([&] {
+		unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = 0;
+		myEvent.reportReservedEvent(eventId);
+	});
+	while (c.nConcurrentConsumers == 0) {
+		this_thread::yield();
+	}
+	thread::id producerId = producer.get_id();
+	BOOST_TEST(c.consumerThreadIds[0] == producerId, "events reported on an idle link should have been consumed inline");
+
+	// with the consumer instance busy, events are queued -- and the dispatcher thread must wait for the instance to be free
+	unsigned int* otherParameterReference;
+	unsigned int eventId = myEvent.reserveEventForReporting(otherParameterReference);
+	*otherParameterReference = 1;
+	myEvent.reportReservedEvent(eventId);
+	this_thread::sleep_for(chrono::milliseconds(10));
+	BOOST_TEST(answerlessConsumedEvents[1] == 0, "the consumer instance was busy: the event should be waiting for it");
+	c.consumerGate.unlock();
+	producer.join();
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(answerlessConsumedEvents[0] == 1);
+	BOOST_TEST(answerlessConsumedEvents[1] == 1);
+	BOOST_TEST(c.consumerThreadIds[1] != producerId,             "events reported under load must go through the queue");
+	BOOST_TEST(c.consumerThreadIds[1] != this_thread::get_id(),  "events reported under load must go through the queue");
+	BOOST_TEST(c.maxConcurrentConsumers == 1,                    "a consumer instance must never be used by two threads at once");
+
+	HEAP_TRACE("inlineWhenIdle", output);
+}
+
+BOOST_AUTO_TEST_CASE(coroutineAwaitables) {
+	HEAP_MARK();
+
+	// coroutines awaiting answers don't hold threads: many of them are resumed, through the executor, as answers are produced
+	static constexpr unsigned int failingEvent = 65535;
+	atomic_uint nResumes(0);
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("coroutineAwaitables tests");
+	auto consumer = [](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		if (n == failingEvent) {
+			throw runtime_error("this event must fail");
+		}
+		*answer = n*2;
+		answerMutex.unlock();
+	};
+	myEvent.setAnswerfullConsumer({consumer, consumer});
+	myEvent.setCoroutineExecutor([&nResumes](std::coroutine_handle<> coroutine) {
+		nResumes++;
+		coroutine.resume();
+	});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 2, 0, true, false, false, true, false);
+
+	static constexpr unsigned int nCoroutines = 10000;
+	atomic_bool hasThrown(false);
+	for (unsigned int i=0; i<nCoroutines; i++) {
+		awaitAnswer(myEvent, i, answerfullConsumedEvents);
+	}
+	awaitFailedAnswer(myEvent, failingEvent, &hasThrown);
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	for (unsigned int i=0; i<nCoroutines; i++) {
+		BOOST_REQUIRE_MESSAGE(answerfullConsumedEvents[i] == i*2, "awaited answer #"+to_string(i)+" is wrong: "+to_string(answerfullConsumedEvents[i]));
+	}
+	BOOST_TEST(hasThrown,                    "exceptions thrown by the consumer before answering must be rethrown to the awaiting coroutine");
+	BOOST_TEST(nResumes <= nCoroutines+1,    "coroutines must be resumed at most once -- and only if they got suspended");
+	output("coroutines suspended & resumed through the executor: " + to_string(nResumes) + "\n");
+
+	HEAP_TRACE("coroutineAwaitables", output);
+}
+
+BOOST_AUTO_TEST_CASE(answerContinuations) {
+	HEAP_MARK();
+
+	// answers are handled by continuations: per event, on the dispatcher thread, and per link, forwarded to a completion link
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> completionEvent("answerContinuations completion link");
+	completionEvent.setAnswerlessConsumer({[this](const unsigned int& answer) { answerlessConsumedEvents[answer/2]++; }});
+	mutua::events::QueueEventDispatcher completionDispatcher(completionEvent, 1, 0, true, false, true, false, false);
+
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("answerContinuations tests");
+	auto consumer = [](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		*answer = n*2;
+		answerMutex.unlock();
+	};
+	myEvent.setAnswerfullConsumer({consumer, consumer});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 2, 0, true, false, false, true, false);
+
+	// per event continuations, with the answer stored on the queue slot
+	decltype(myEvent)::AnswerHandler answerHandler = [this](const unsigned int& n, unsigned int* answer, const exception_ptr& exception) {
+		answerfullConsumedEvents[n] = *answer;
+	};
+	unsigned int* reservedParameterReference;
+	for (unsigned int i=0; i<32768; i++) {
+		unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference, answerHandler);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+
+	// per link continuation, forwarding the answers
+	unsigned int answers[32768];
+	myEvent.setAnswerHandler(decltype(myEvent)::answersTo(completionEvent));
+	for (unsigned int i=32768; i<65536; i++) {
+		unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference, &answers[i-32768]);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(completionDispatcher.stopWhenEmpty() == 0);
+	for (unsigned int i=0; i<32768; i++) {
+		BOOST_REQUIRE_MESSAGE(answerfullConsumedEvents[i] == i*2, "answer handled for event #"+to_string(i)+" is wrong: "+to_string(answerfullConsumedEvents[i]));
+	}
+	for (unsigned int i=32768; i<65536; i++) {
+		BOOST_REQUIRE_MESSAGE(answerlessConsumedEvents[i] == 1, "answer for event #"+to_string(i)+" was not forwarded to the completion link");
+	}
+
+	HEAP_TRACE("answerContinuations", output);
+}
+
+BOOST_AUTO_TEST_CASE(awaitingWithAnswerHandler) {
+	HEAP_MARK();
+
+	// coroutines awaiting with 'reportAndAwait(...)' get their answers even if the link has an answer handler -- which gets the others
+	mutex consumerGate;
+	atomic_uint nHandledAnswers(0);
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("awaitingWithAnswerHandler tests");
+	myEvent.setAnswerfullConsumer({[&consumerGate](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		scoped_lock<mutex> lock(consumerGate);
+		*answer = n*2;
+		answerMutex.unlock();
+	}});
+	myEvent.setAnswerHandler([&nHandledAnswers](const unsigned int& n, unsigned int* answer, const exception_ptr& exception) {
+		nHandledAnswers++;
+	});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, false, true, false);
+
+	// the consumer is held, so the coroutine suspends
+	consumerGate.lock();
+	awaitAnswer(myEvent, 21, answerfullConsumedEvents);
+	unsigned int  answer;
+	unsigned int* reservedParameterReference;
+	int eventId = myEvent.reserveEventForReporting(reservedParameterReference, &answer);
+	*reservedParameterReference = 22;
+	myEvent.reportReservedEvent(eventId);
+	consumerGate.unlock();
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(answerfullConsumedEvents[21] == 42, "the awaiting coroutine must be resumed with its answer");
+	BOOST_TEST(nHandledAnswers == 1,               "the link's answer handler must get the answers of the events not being awaited -- and only those");
+
+	HEAP_TRACE("awaitingWithAnswerHandler", output);
+}
+
+BOOST_AUTO_TEST_CASE(nonDefaultConstructibleAnswers) {
+	HEAP_MARK();
+
+	// queue slots don't store answers: they need not be default constructible, unless the link is asked to store them for an answer handler
+	struct Answer {
+		unsigned int value;
+		Answer(unsigned int value) : value(value) {}
+	};
+	mutua::events::QueueEventLink<Answer, unsigned int, 10, 4> myEvent("nonDefaultConstructibleAnswers tests");
+	myEvent.setAnswerfullConsumer({[](const unsigned int& n, Answer* answer, std::mutex& answerMutex) {
+		*answer = Answer(n*2);
+		answerMutex.unlock();
+	}});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, false, true, false);
+
+	Answer answer(0);
+	BOOST_TEST(myEvent.reportAndWaitForAnswer(21, &answer)->value == 42);
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+
+	HEAP_TRACE("nonDefaultConstructibleAnswers", output);
+}
+
+BOOST_AUTO_TEST_CASE(answerGroups) {
+	HEAP_MARK();
+
+	// two links of different types: a slow one, held by 'consumerGate', and a fast one
+	mutex consumerGate;
+	consumerGate.lock();
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> slowEvent("answerGroups slow link");
+	slowEvent.setAnswerfullConsumer({[&consumerGate](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		consumerGate.lock();
+		consumerGate.unlock();
+		*answer = n+1;
+		answerMutex.unlock();
+	}});
+	mutua::events::QueueEventDispatcher slowDispatcher(slowEvent, 1, 0, true, false, false, true, false);
+	mutua::events::QueueEventLink<unsigned long long, unsigned int, 10, 4> fastEvent("answerGroups fast link");
+	fastEvent.setAnswerfullConsumer({[](const unsigned int& n, unsigned long long* answer, std::mutex& answerMutex) {
+		*answer = n*1'000'000'000'000ull;
+		answerMutex.unlock();
+	}});
+	mutua::events::QueueEventDispatcher fastDispatcher(fastEvent, 1, 0, true, false, false, true, false);
+
+	unsigned int       slowAnswer;
+	unsigned long long fastAnswer;
+	unsigned int*      reservedParameterReference;
+	int slowEventId = slowEvent.reserveEventForReporting(reservedParameterReference, &slowAnswer);
+	*reservedParameterReference = 1;
+	slowEvent.reportReservedEvent(slowEventId);
+	int fastEventId = fastEvent.reserveEventForReporting(reservedParameterReference, &fastAnswer);
+	*reservedParameterReference = 2;
+	fastEvent.reportReservedEvent(fastEventId);
+	auto slowHandle = slowEvent.getAnswerHandle(slowEventId);
+	auto fastHandle = fastEvent.getAnswerHandle(fastEventId);
+
+	BOOST_TEST(mutua::events::waitForAnyAnswer(slowHandle, fastHandle) == 1,                            "the fast event should have been the first to be answered");
+	BOOST_TEST(*fastHandle.waitForAnswer() == 2'000'000'000'000ull);
+	BOOST_TEST(!mutua::events::waitForAllAnswers(chrono::milliseconds(10), slowHandle, fastHandle),    "the slow event is held: not all answers should be ready");
+	BOOST_TEST(mutua::events::waitForAnyAnswer(chrono::milliseconds(10), slowHandle) == -1,             "the slow event is held: waiting for it should time out");
+	consumerGate.unlock();
+	mutua::events::waitForAllAnswers(slowHandle, fastHandle);
+	BOOST_TEST(*slowHandle.waitForAnswer() == 2);
+	BOOST_TEST(mutua::events::waitForAllAnswers(chrono::milliseconds(10), slowHandle, fastHandle),     "already answered events should satisfy the group right away");
+
+	BOOST_TEST(slowDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(fastDispatcher.stopWhenEmpty() == 0);
+
+	HEAP_TRACE("answerGroups", output);
+}
+
+BOOST_AUTO_TEST_CASE(returningConsumers) {
+	HEAP_MARK();
+
+	// consumers simply return the answer -- storing it & waking up the waiters is up to the framework
+	static constexpr unsigned int failingEvent = 65535;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("returningConsumers tests");
+	auto consumer = [this](const unsigned int& n) -> unsigned int {
+		if (n == failingEvent) {
+			throw runtime_error("this event must fail");
+		}
+		answerlessConsumedEvents[n]++;
+		return n*3;
+	};
+	myEvent.setReturningConsumer({consumer, consumer, consumer, consumer});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 4, 0, true, true, false, true, false);
+	myEvent.addListener([this](const unsigned int& n) { notifyedEvents[n]++; });
+
+	// answerfull events, from several producers
+	auto producer = [this, &myEvent](unsigned int start, unsigned int end) {
+		unsigned int* reservedParameterReference;
+		for (unsigned int i=start; i<end; i++) {
+			unsigned int answer;
+			unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference, &answer);
+			*reservedParameterReference = i;
+			myEvent.reportReservedEvent(eventId);
+			// the slot may already be reused by another producer when we get to wait for it -- so look at our own answer, not the slot's
+			myEvent.waitForAnswer(eventId);
+			answerfullConsumedEvents[i] = answer;
+		}
+	};
+	thread producers[4];
+	for (unsigned int p=0; p<4; p++) {
+		producers[p] = thread(producer, p*8192, (p+1)*8192);
+	}
+	for (thread& p : producers) {
+		p.join();
+	}
+
+	// answerless events on the same link
+	unsigned int* reservedParameterReference;
+	for (unsigned int i=32768; i<65535; i++) {
+		unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+
+	// failing consumers must not hang the producer
+	unsigned int answer;
+	unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference, &answer);
+	*reservedParameterReference = failingEvent;
+	myEvent.reportReservedEvent(eventId);
+	BOOST_CHECK_THROW(myEvent.waitForAnswer(eventId), runtime_error);
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	for (unsigned int i=0; i<32768; i++) {
+		BOOST_REQUIRE_MESSAGE(answerfullConsumedEvents[i] == i*3, "answer #"+to_string(i)+" is wrong: "+to_string(answerfullConsumedEvents[i]));
+	}
+	for (unsigned int i=0; i<65535; i++) {
+		BOOST_REQUIRE_MESSAGE(answerlessConsumedEvents[i] == 1, "event #"+to_string(i)+" was consumed "+to_string(answerlessConsumedEvents[i])+" times");
+		BOOST_REQUIRE_MESSAGE(notifyedEvents[i] == 1,           "event #"+to_string(i)+" was notified "+to_string(notifyedEvents[i])+" times");
+	}
+
+	// answers are published once per batch -- but the ones produced before a slow consumer aren't held back for longer than it takes
+	mutex consumerGate;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> batchEvent("returningConsumers batch tests");
+	batchEvent.setReturningConsumer({[&consumerGate](const unsigned int& n) -> unsigned int {
+		if (n == 2) {
+			this_thread::sleep_for(chrono::milliseconds(10));
+		} else if (n == 3) {
+			scoped_lock<mutex> lock(consumerGate);
+		}
+		return n*3;
+	}});
+	unsigned int batchAnswers[3];
+	int          batchEventIds[3];
+	for (unsigned int i=0; i<3; i++) {
+		batchEventIds[i] = batchEvent.reserveEventForReporting(reservedParameterReference, &batchAnswers[i]);
+		*reservedParameterReference = i+1;
+		batchEvent.reportReservedEvent(batchEventIds[i]);
+	}
+	consumerGate.lock();
+	mutua::events::QueueEventDispatcher batchDispatcher(batchEvent, 1, 0, true, false, false, true, false);	// all events are dequeued at once
+	unsigned int* firstAnswer  = batchEvent.waitForAnswer(batchEventIds[0], chrono::seconds(10));
+	unsigned int* secondAnswer = batchEvent.waitForAnswer(batchEventIds[1], chrono::seconds(10));
+	consumerGate.unlock();
+	BOOST_TEST((firstAnswer  != nullptr && *firstAnswer  == 3), "answers held for longer than 'returningAnswersMaxDelayNS' must be published before the rest of the batch is consumed");
+	BOOST_TEST((secondAnswer != nullptr && *secondAnswer == 6), "answers held for longer than 'returningAnswersMaxDelayNS' must be published before the rest of the batch is consumed");
+	BOOST_TEST(*batchEvent.waitForAnswer(batchEventIds[2]) == 9);
+	BOOST_TEST(batchDispatcher.stopWhenEmpty() == 0);
+
+	HEAP_TRACE("returningConsumers", output);
+}
+
+BOOST_AUTO_TEST_CASE(streamingAnswers) {
+	HEAP_MARK();
+
+	// the consumer streams 'n' chunks, holding the last ones until 'consumerGate' is opened -- or fails after 'n' chunks, if 'n' is odd
+	typedef mutua::events::AnswerStream<string, 3> StringStream;
+	mutex consumerGate;
+	consumerGate.lock();
+	mutua::events::QueueEventLink<StringStream, unsigned int, 10, 4> myEvent("streamingAnswers tests");
+	myEvent.setStreamingConsumer({[&consumerGate](const unsigned int& n, StringStream& answer) {
+		for (unsigned int i=0; i<n; i++) {
+			if (i == 1) {
+				consumerGate.lock();
+				consumerGate.unlock();
+			}
+			answer.push("chunk #"+to_string(i));
+		}
+		if (n%2 == 1) {
+			throw runtime_error("this stream must fail");
+		}
+	}});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, false, true, false);
+
+	StringStream  answer;
+	string        chunk;
+	unsigned int* reservedParameterReference;
+	int eventId = myEvent.reserveEventForReporting(reservedParameterReference, &answer);
+	*reservedParameterReference = 100;
+	myEvent.reportReservedEvent(eventId);
+	BOOST_TEST(answer.pop(chunk),           "the first chunk should be available while the rest of the answer is still being produced");
+	BOOST_TEST(chunk == "chunk #0");
+	consumerGate.unlock();
+	unsigned int nChunks = 1;
+	while (answer.pop(chunk)) {
+		BOOST_REQUIRE(chunk == "chunk #"+to_string(nChunks));
+		nChunks++;
+	}
+	BOOST_TEST(nChunks == 100,              "all chunks should have been streamed -- through a stream with room for only 8 of them");
+	BOOST_TEST(myEvent.waitForAnswer(eventId) == &answer);
+
+	StringStream failingAnswer;
+	eventId = myEvent.reserveEventForReporting(reservedParameterReference, &failingAnswer);
+	*reservedParameterReference = 3;
+	myEvent.reportReservedEvent(eventId);
+	nChunks = 0;
+	BOOST_CHECK_THROW(while (failingAnswer.pop(chunk)) nChunks++, runtime_error);
+	BOOST_TEST(nChunks == 3,                "chunks pushed before the consumer failed should have been streamed");
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+
+	HEAP_TRACE("streamingAnswers", output);
+}
+
+BOOST_AUTO_TEST_CASE(cancellation) {
+	HEAP_MARK();
+
+	// event #0 runs until cancelled, holding the single dispatcher thread, so the following events stay queued
+	struct {
+		mutex started;
+		QueueEventLinkSuiteObjects* fixture;
+	} c;
+	c.started.lock();
+	c.fixture = this;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("cancellation tests");
+	myEvent.setAnswerfullConsumer({[&c](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		if (n == 0) {
+			c.started.unlock();
+			while (!mutua::events::isCurrentEventCancelled()) {
+				this_thread::yield();
+			}
+			throw mutua::events::EventCancelled("event #0 gave up");
+		}
+		c.fixture->answerfullConsumedEvents[n]++;
+		*answer = n*2;
+		answerMutex.unlock();
+	}});
+	myEvent.addListener([this](const unsigned int& n) { notifyedEvents[n]++; });
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, true, false, true, false);
+
+	unsigned int  answers[6];
+	int           eventIds[6];
+	unsigned int* reservedParameterReference;
+	for (unsigned int i=0; i<6; i++) {
+		eventIds[i] = myEvent.reserveEventForReporting(reservedParameterReference, &answers[i]);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventIds[i]);
+		if (i == 0) {
+			c.started.lock();
+		}
+	}
+
+	// queued events: skipped by the dispatcher, with their waiters released right away
+	BOOST_TEST(myEvent.cancelEvent(eventIds[2]),                            "queued events should be cancelled before being consumed");
+	BOOST_TEST(myEvent.getAnswerHandle(eventIds[4]).cancel(),               "queued events should be cancelled before being consumed");
+	BOOST_CHECK_THROW(myEvent.waitForAnswer(eventIds[2]), mutua::events::EventCancelled);
+	BOOST_CHECK_THROW(myEvent.waitForAnswer(eventIds[4]), mutua::events::EventCancelled);
+
+	// running event: only the cancellation token is set
+	BOOST_TEST(!myEvent.cancelEvent(eventIds[0]),                           "running events can only be asked to give up");
+	BOOST_CHECK_THROW(myEvent.waitForAnswer(eventIds[0]), mutua::events::EventCancelled);
+
+	for (unsigned int i : {1, 3, 5}) {
+		BOOST_TEST(*myEvent.waitForAnswer(eventIds[i]) == i*2);
+	}
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	for (unsigned int i=1; i<6; i++) {
+		unsigned int expected = (i%2 == 0) ? 0 : 1;
+		BOOST_TEST(answerfullConsumedEvents[i] == expected,                 "event #"+to_string(i)+" was consumed "+to_string(answerfullConsumedEvents[i])+" times");
+		BOOST_TEST(notifyedEvents[i] == expected,                           "event #"+to_string(i)+" was notified "+to_string(notifyedEvents[i])+" times");
+	}
+
+	HEAP_TRACE("cancellation", output);
+}
+
+BOOST_AUTO_TEST_CASE(deadlines) {
+	HEAP_MARK();
+
+	// the single dispatcher thread is held on event #0 while the following events get past their deadlines
+	mutex consumerGate;
+	consumerGate.lock();
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("deadlines tests");
+	myEvent.setAnswerfullConsumer({[&consumerGate](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		if (n == 0) {
+			consumerGate.lock();
+			consumerGate.unlock();
+		}
+		*answer = n*2;
+		answerMutex.unlock();
+	}});
+	myEvent.addListener([this](const unsigned int& n) { notifyedEvents[n]++; });
+	myEvent.setEventsTimeToLive(chrono::milliseconds(20), [this](const unsigned int& n) { answerlessConsumedEvents[n]++; });
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, true, false, true, false);
+
+	unsigned int  answers[5];
+	int           eventIds[5];
+	unsigned int* reservedParameterReference;
+	for (unsigned int i=0; i<5; i++) {
+		eventIds[i] = myEvent.reserveEventForReporting(reservedParameterReference, &answers[i]);
+		*reservedParameterReference = i;
+		if (i == 4) {
+			myEvent.setEventDeadline(eventIds[i], chrono::steady_clock::now() + chrono::hours(1));
+		}
+		myEvent.reportReservedEvent(eventIds[i]);
+	}
+
+	// timed waits
+	BOOST_TEST(myEvent.waitForAnswer(eventIds[0], chrono::milliseconds(40)) == nullptr,    "event #0 is held: waiting for it should time out");
+	consumerGate.unlock();
+	BOOST_TEST(*myEvent.waitForAnswer(eventIds[0], chrono::seconds(10)) == 0u);
+
+	// expired events are dropped, with their waiters failing
+	for (unsigned int i=1; i<4; i++) {
+		BOOST_CHECK_THROW(myEvent.waitForAnswer(eventIds[i]), mutua::events::EventExpired);
+	}
+	BOOST_TEST(*myEvent.waitForAnswer(eventIds[4]) == 8u,                                  "events with an explicit deadline should not expire");
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(myEvent.getNumberOfExpiredEvents() == 3u);
+	for (unsigned int i=0; i<5; i++) {
+		bool isExpired = (i >= 1) && (i <= 3);
+		BOOST_TEST(notifyedEvents[i]           == (isExpired ? 0u : 1u),                   "event #"+to_string(i)+" was notified "+to_string(notifyedEvents[i])+" times");
+		BOOST_TEST(answerlessConsumedEvents[i] == (isExpired ? 1u : 0u),                   "event #"+to_string(i)+" was reported as expired "+to_string(answerlessConsumedEvents[i])+" times");
+	}
+
+	HEAP_TRACE("deadlines", output);
+}
+
+BOOST_AUTO_TEST_CASE(singleFlight) {
+	HEAP_MARK();
+
+	// consumers are held until 'consumerGate' is opened, so identical reports pile up while the first one is in flight
+	static constexpr unsigned int failingEvent = 13;
+	static constexpr unsigned int nReporters   = 8;
+	mutex consumerGate;
+	consumerGate.lock();
+	struct {
+		mutex*                       consumerGate;
+		QueueEventLinkSuiteObjects* fixture;
+	} c = {&consumerGate, this};
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("singleFlight tests");
+	auto consumer = [&c](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		c.consumerGate->lock();
+		c.consumerGate->unlock();
+		c.fixture->answerfullConsumedEvents[n]++;
+		if (n == failingEvent) {
+			throw runtime_error("this flight must fail");
+		}
+		*answer = n*2;
+		answerMutex.unlock();
+	};
+	myEvent.setAnswerfullConsumer({consumer, consumer});
+	myEvent.setSingleFlight([](const unsigned int& n) { return (size_t)n; },
+	                        [](const unsigned int& a, const unsigned int& b) { return a == b; });
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 2, 0, true, false, false, true, false);
+
+	atomic_uint nFailures(0);
+	auto reporter = [this, &myEvent, &nFailures](unsigned int n) {
+		unsigned int answer = 0;
+		try {
+			answerlessConsumedEvents[*myEvent.reportAndWaitForAnswer(n, &answer)]++;
+		} catch (const runtime_error& e) {
+			nFailures++;
+		}
+	};
+	thread reporters[nReporters*2];
+	for (unsigned int i=0; i<nReporters; i++) {
+		reporters[i]            = thread(reporter, 7);
+		reporters[nReporters+i] = thread(reporter, failingEvent);
+	}
+	while (myEvent.getNumberOfCollapsedEvents() < (nReporters-1)*2) {
+		this_thread::yield();
+	}
+	consumerGate.unlock();
+	for (thread& r : reporters) {
+		r.join();
+	}
+
+	BOOST_TEST(answerfullConsumedEvents[7] == 1u,             "identical events should have been consumed only once");
+	BOOST_TEST(answerlessConsumedEvents[14] == nReporters,    "all reporters should have received the same answer");
+	BOOST_TEST(answerfullConsumedEvents[failingEvent] == 1u,  "identical failing events should have been consumed only once");
+	BOOST_TEST(nFailures == nReporters,                       "all reporters should have received the same exception");
+
+	// once landed, identical events take a new flight
+	unsigned int answer;
+	BOOST_TEST(*myEvent.reportAndWaitForAnswer(7, &answer) == 14u);
+	BOOST_TEST(answerfullConsumedEvents[7] == 2u);
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+
+	HEAP_TRACE("singleFlight", output);
+}
+
+BOOST_AUTO_TEST_CASE(answerCache) {
+	HEAP_MARK();
+
+	static constexpr unsigned int updatedWhileConsumed = 100;
+	mutua::events::AnswerCache<unsigned int, unsigned int, 2, 6> cache;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("answerCache tests");
+	myEvent.setAnswerfullConsumer({[this, &cache](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+		answerfullConsumedEvents[n]++;
+		*answer = n*2;
+		if (n == updatedWhileConsumed) {
+			cache.invalidate(n);	// as if an update got in while the answer was being produced
+		}
+		answerMutex.unlock();
+	}});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, false, true, false);
+	myEvent.setAnswerCache(cache);
+
+	// updates invalidate cached answers
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> updateEvent("answerCache update tests");
+	updateEvent.setAnswerlessConsumer({[](const unsigned int& n) {}});
+	cache.invalidateOn(updateEvent);
+	mutua::events::QueueEventDispatcher updateDispatcher(updateEvent, 1, 0, true, true, true, false, false);
+
+	unsigned int answer;
+	for (unsigned int pass=0; pass<3; pass++) {
+		for (unsigned int i=0; i<10; i++) {
+			BOOST_REQUIRE(*myEvent.reportAndWaitForAnswer(i, &answer) == i*2);
+		}
+	}
+	BOOST_TEST(cache.getNumberOfMisses() == 10u);
+	BOOST_TEST(cache.getNumberOfHits()   == 20u);
+	unsigned int* reservedParameterReference;
+	int eventId = updateEvent.reserveEventForReporting(reservedParameterReference);
+	*reservedParameterReference = 3;
+	updateEvent.reportReservedEvent(eventId);
+	BOOST_TEST(updateDispatcher.stopWhenEmpty() == 0);
+	for (unsigned int i=0; i<10; i++) {
+		BOOST_REQUIRE(*myEvent.reportAndWaitForAnswer(i, &answer) == i*2);
+		BOOST_TEST(answerfullConsumedEvents[i] == (i == 3 ? 2u : 1u),   "event #"+to_string(i)+" was consumed "+to_string(answerfullConsumedEvents[i])+" times");
+	}
+	// answers produced before an invalidation are not cached
+	BOOST_REQUIRE(*myEvent.reportAndWaitForAnswer(updatedWhileConsumed, &answer) == updatedWhileConsumed*2);
+	BOOST_TEST(!cache.lookup(updatedWhileConsumed, &answer),            "an answer produced before an invalidation must not be cached");
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+
+	// expiration & bounds
+	mutua::events::AnswerCache<unsigned int, unsigned int, 1, 4> smallCache(chrono::milliseconds(20));
+	for (unsigned int i=0; i<1000; i++) {
+		smallCache.store(i, i*2);
+	}
+	unsigned int nCached = 0;
+	for (unsigned int i=0; i<1000; i++) {
+		if (smallCache.lookup(i, &answer)) {
+			BOOST_REQUIRE(answer == i*2);
+			nCached++;
+		}
+	}
+	BOOST_TEST(nCached == 32u,                                          "the cache should be full, but never above its 32 entries");
+	this_thread::sleep_for(chrono::milliseconds(30));
+	BOOST_TEST(!smallCache.lookup(999, &answer),                        "expired answers should not be returned");
+
+	HEAP_TRACE("answerCache", output);
+}
+
+BOOST_AUTO_TEST_CASE(keyOrderedDispatching) {
+	HEAP_MARK();
+
+	// events are 'key*100'000 + sequence': each key's sequence must be consumed in order, even with several dispatcher threads
+	static constexpr unsigned int nKeys      = 16;
+	static constexpr unsigned int nSequences = 64;	// 1024 events: they must fit in the queue
+	struct {
+		atomic_uint nextSequences[nKeys];
+		atomic_uint nOutOfOrder;
+	} c;
+	for (atomic_uint& nextSequence : c.nextSequences) {
+		nextSequence = 0;
+	}
+	c.nOutOfOrder = 0;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 11> myEvent("keyOrderedDispatching tests");
+	auto consumer = [&c](const unsigned int& n) {
+		unsigned int key      = n / 100'000;
+		unsigned int sequence = n % 100'000;
+		if (c.nextSequences[key].load() != sequence) {
+			c.nOutOfOrder++;
+		}
+		if (((key + sequence) % 7) == 0) {
+			// uneven consumption times give other threads the chance to overtake
+			this_thread::sleep_for(chrono::microseconds(10));
+		}
+		c.nextSequences[key].store(sequence+1);
+	};
+	myEvent.setAnswerlessConsumer({consumer, consumer, consumer, consumer});
+	myEvent.setKeyOrderedDispatching([](const unsigned int& n) { return (size_t)(n / 100'000); }, 8);
+
+	// the queue is filled before the dispatcher threads start, so they all have events to compete for
+	unsigned int* reservedParameterReference;
+	for (unsigned int sequence=0; sequence<nSequences; sequence++) {
+		for (unsigned int key=0; key<nKeys; key++) {
+			int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+			*reservedParameterReference = key*100'000 + sequence;
+			myEvent.reportReservedEvent(eventId);
+		}
+	}
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 4, 0, true, false, true, false, false);
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+
+	BOOST_TEST(c.nOutOfOrder == 0u,                                     "events of the same key were consumed out of order");
+	for (unsigned int key=0; key<nKeys; key++) {
+		BOOST_TEST(c.nextSequences[key] == nSequences,                  "not all events of key #"+to_string(key)+" were consumed");
+	}
+
+	// a busy key must not hold dispatcher threads: while the 1st event of key 0 is being consumed, its next events are deferred to
+	// the lane holder and the other thread goes on consuming key 1
+	mutex       gate;
+	atomic_uint nHotKeyEvents(0);
+	atomic_uint nOtherKeyEvents(0);
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> hotKeyEvent("keyOrderedDispatching hot key tests");
+	auto hotKeyConsumer = [&](const unsigned int& n) {
+		if (n / 100'000 == 0) {
+			scoped_lock<mutex> lock(gate);
+			nHotKeyEvents++;
+		} else {
+			nOtherKeyEvents++;
+		}
+	};
+	hotKeyEvent.setAnswerlessConsumer({hotKeyConsumer, hotKeyConsumer});
+	hotKeyEvent.setKeyOrderedDispatching([](const unsigned int& n) { return (size_t)(n / 100'000); }, 2);
+	gate.lock();
+	for (unsigned int n : {0u, 1u, 2u, 100'000u, 100'001u, 100'002u}) {
+		int eventId = hotKeyEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = n;
+		hotKeyEvent.reportReservedEvent(eventId);
+	}
+	mutua::events::QueueEventDispatcher hotKeyDispatcher(hotKeyEvent, 2, 0, true, false, true, false, false);
+	for (int i=0; (i<5000) && (nOtherKeyEvents < 3); i++) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	BOOST_TEST(nOtherKeyEvents == 3u,                                   "a busy key held the dispatcher threads back");
+	BOOST_TEST(nHotKeyEvents   == 0u);
+	gate.unlock();
+	BOOST_TEST(hotKeyDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(nHotKeyEvents   == 3u,                                   "the deferred events of the busy key were not consumed");
+
+	HEAP_TRACE("keyOrderedDispatching", output);
+}
+
+BOOST_AUTO_TEST_CASE(multicastDispatching) {
+	HEAP_MARK();
+
+	// a fast and a slow (held by 'slowGate') multicast listener follow the same events consumed by the dispatcher
+	static constexpr unsigned int nEvents = 10000;
+	mutex slowGate;
+	slowGate.lock();
+	struct {
+		atomic_uint fastNotifications[nEvents];
+		atomic_uint slowNotifications[nEvents];
+		mutex*      slowGate;
+	} *c = new remove_pointer_t<decltype(c)>;
+	for (unsigned int i=0; i<nEvents; i++) {
+		c->fastNotifications[i] = 0;
+		c->slowNotifications[i] = 0;
+	}
+	c->slowGate = &slowGate;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("multicastDispatching tests");
+	myEvent.setAnswerlessConsumer({[this](const unsigned int& n) { answerlessConsumedEvents[n]++; }});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, true, false, false);
+	mutua::events::MulticastDispatcher fastListeners(myEvent, {[c](const unsigned int& n) { c->fastNotifications[n]++; }});
+	mutua::events::MulticastDispatcher slowListeners(myEvent, {[c](const unsigned int& n) {
+		if (n == 0) {
+			c->slowGate->lock();
+			c->slowGate->unlock();
+		}
+		c->slowNotifications[n]++;
+	}});
+
+	atomic_uint nReported(0);
+	thread producer([&myEvent, &nReported]() {
+		unsigned int* reservedParameterReference;
+		for (unsigned int i=0; i<nEvents; i++) {
+			int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+			*reservedParameterReference = i;
+			myEvent.reportReservedEvent(eventId);
+			nReported++;
+		}
+	});
+	this_thread::sleep_for(chrono::milliseconds(50));
+	BOOST_TEST(nReported <= 16u,                                        "slots not yet read by the slow listeners should not have been reclaimed");
+	slowGate.unlock();
+	producer.join();
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(fastListeners.join() == nEvents);
+	BOOST_TEST(slowListeners.join() == nEvents);
+	for (unsigned int i=0; i<nEvents; i++) {
+		BOOST_REQUIRE_MESSAGE(answerlessConsumedEvents[i] == 1,     "event #"+to_string(i)+" was consumed "+to_string(answerlessConsumedEvents[i])+" times");
+		BOOST_REQUIRE_MESSAGE(c->fastNotifications[i] == 1,         "event #"+to_string(i)+" was multicast to the fast listeners "+to_string(c->fastNotifications[i])+" times");
+		BOOST_REQUIRE_MESSAGE(c->slowNotifications[i] == 1,         "event #"+to_string(i)+" was multicast to the slow listeners "+to_string(c->slowNotifications[i])+" times");
+	}
+	delete c;
+
+	HEAP_TRACE("multicastDispatching", output);
+}
+
+BOOST_AUTO_TEST_CASE(pipelineStages) {
+	HEAP_MARK();
+
+	// decode -> enrich -> persist, all working on the same slots
+	struct Message {
+		unsigned int raw;
+		unsigned int decoded;
+		unsigned int enriched;
+		static string toString(const Message& m) { return to_string(m.raw); }
+	};
+	static constexpr unsigned int nEvents = 10000;
+	atomic_uint nBadlyOrdered(0);
+	mutua::events::QueueEventLink<unsigned int, Message, 10, 4> myEvent("pipelineStages tests");
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, true, false, false, false);
+	mutua::events::MulticastDispatcher decode(myEvent,  {},         {[](Message& m) { m.decoded = m.raw * 2; }});
+	mutua::events::MulticastDispatcher enrich(myEvent,  {&decode},  {[](Message& m) { m.enriched = m.decoded + 1; }});
+	mutua::events::MulticastDispatcher persist(myEvent, {&enrich},  {[this, &nBadlyOrdered](Message& m) {
+		if ( (m.decoded != m.raw*2) || (m.enriched != m.raw*2+1) ) {
+			nBadlyOrdered++;
+		}
+		answerlessConsumedEvents[m.raw]++;
+	}});
+
+	Message* reservedParameterReference;
+	for (unsigned int i=0; i<nEvents; i++) {
+		int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = {i, 0, 0};
+		myEvent.reportReservedEvent(eventId);
+	}
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(persist.join() == nEvents);
+	BOOST_TEST(enrich.join()  == nEvents);
+	BOOST_TEST(decode.join()  == nEvents);
+	BOOST_TEST(nBadlyOrdered == 0u,                                     "a stage ran before the ones it depends on");
+	for (unsigned int i=0; i<nEvents; i++) {
+		BOOST_REQUIRE_MESSAGE(answerlessConsumedEvents[i] == 1,     "event #"+to_string(i)+" was persisted "+to_string(answerlessConsumedEvents[i])+" times");
+	}
+
+	HEAP_TRACE("pipelineStages", output);
+}
+
+BOOST_AUTO_TEST_CASE(linkConnector) {
+	HEAP_MARK();
+
+	// upstream -> downstream, whose consumer is held by 'consumerGate'
+	static constexpr unsigned int nEvents = 1000;
+	mutex consumerGate;
+	consumerGate.lock();
+	struct {
+		mutex*       consumerGate;
+		atomic_uint  nConsumed;
+		atomic_uint  nOutOfOrder;
+	} c;
+	c.consumerGate = &consumerGate;
+	c.nConsumed    = 0;
+	c.nOutOfOrder  = 0;
+	mutua::events::QueueEventLink<unsigned int, string, 10, 4> upstream("linkConnector upstream tests");
+	mutua::events::QueueEventLink<unsigned int, string, 10, 4> downstream("linkConnector downstream tests");
+	downstream.setAnswerlessConsumer({[&c](const string& s) {
+		c.consumerGate->lock();
+		c.consumerGate->unlock();
+		if (s != "event #"+to_string(c.nConsumed)) {
+			c.nOutOfOrder++;
+		}
+		c.nConsumed++;
+	}});
+	mutua::events::QueueEventDispatcher downstreamDispatcher(downstream, 1, 0, true, false, true, false, false);
+	mutua::events::LinkConnector connector(upstream, downstream);
+
+	atomic_uint nReported(0);
+	thread producer([&upstream, &nReported]() {
+		string* reservedParameterReference;
+		for (unsigned int i=0; i<nEvents; i++) {
+			int eventId = upstream.reserveEventForReporting(reservedParameterReference);
+			*reservedParameterReference = "event #"+to_string(i);
+			upstream.reportReservedEvent(eventId);
+			nReported++;
+		}
+	});
+	// wait for the pipeline to jam: both links full -- after which no event may move until the consumer is released
+	for (int i=0; (i<10000) && ( (downstream.getQueueLength() < 15) || (upstream.getQueueLength() < 16) ); i++) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	BOOST_TEST(downstream.getQueueLength() == 15,                       "the downstream link should be full -- but for the event held by its consumer");
+	BOOST_TEST(upstream.getQueueLength() == 16,                         "with no credits, upstream events should stay queued");
+	BOOST_TEST(nReported <= 16u+16u,                                    "the backpressure should have reached the upstream producer");
+	consumerGate.unlock();
+	producer.join();
+
+	upstream.close();
+	BOOST_TEST(connector.join() == nEvents);
+	BOOST_TEST(downstreamDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(c.nConsumed == nEvents);
+	BOOST_TEST(c.nOutOfOrder == 0u);
+
+	// fan-in, with several forwarding threads: no downstream slot may be held while the upstream link is idle -- it would hold back
+	// the events reported directly on the downstream link as well as the ones forwarded by the other threads
+	static constexpr unsigned int nFanInEvents = 5;
+	atomic_uint nFanInConsumed(0);
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> fanInUpstream("linkConnector fan-in upstream tests");
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> fanInDownstream("linkConnector fan-in downstream tests");
+	fanInDownstream.setAnswerlessConsumer({[&nFanInConsumed](const unsigned int& n) { nFanInConsumed++; }});
+	mutua::events::QueueEventDispatcher fanInDispatcher(fanInDownstream, 1, 0, true, false, true, false, false);
+	mutua::events::LinkConnector fanInConnector(fanInUpstream, fanInDownstream, 2);
+	auto reportFanInEvent = [](mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4>& link, unsigned int n) {
+		unsigned int* reservedParameterReference;
+		int eventId = link.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = n;
+		link.reportReservedEvent(eventId);
+	};
+	auto waitForFanInConsumption = [&nFanInConsumed](unsigned int n) {
+		for (int i=0; (i<5000) && (nFanInConsumed < n); i++) {
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		return nFanInConsumed == n;
+	};
+	this_thread::sleep_for(chrono::milliseconds(10));		// let the forwarding threads wait on the idle upstream link
+	for (unsigned int i=0; i<nFanInEvents; i++) {
+		reportFanInEvent(fanInDownstream, i);
+		BOOST_REQUIRE_MESSAGE(waitForFanInConsumption(i+1),             "direct downstream event #"+to_string(i)+" was held back by the connector");
+	}
+	for (unsigned int i=0; i<nFanInEvents; i++) {
+		reportFanInEvent(fanInUpstream, i);
+		BOOST_REQUIRE_MESSAGE(waitForFanInConsumption(nFanInEvents+i+1), "forwarded event #"+to_string(i)+" was held back by the connector");
+	}
+	fanInUpstream.close();
+	BOOST_TEST(fanInConnector.join() == nFanInEvents);
+	BOOST_TEST(fanInDispatcher.stopWhenEmpty() == 0);
+
+	HEAP_TRACE("linkConnector", output);
+}
+
+BOOST_AUTO_TEST_CASE(conflation) {
+	HEAP_MARK();
+
+	// 4 instruments, each with many price updates: 'update*nKeys + key'
+	static constexpr unsigned int nKeys    = 4;
+	static constexpr unsigned int nUpdates = 10000;
+	mutex consumerGate;
+	consumerGate.lock();
+	struct {
+		mutex*       consumerGate;
+		unsigned int lastConsumed[nKeys];
+		unsigned int nConsumed;
+		unsigned int nOutOfOrder;
+	} c;
+	c.consumerGate = &consumerGate;
+	c.nConsumed    = 0;
+	c.nOutOfOrder  = 0;
+	for (unsigned int& lastConsumed : c.lastConsumed) {
+		lastConsumed = 0;
+	}
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> myEvent("conflation tests");
+	myEvent.setConflation([](const unsigned int& n) -> size_t { return n % nKeys; });
+	myEvent.setAnswerlessConsumer({[&c](const unsigned int& n) {
+		if (c.nConsumed == 0) {
+			c.consumerGate->lock();
+			c.consumerGate->unlock();
+		}
+		if ( (c.nConsumed >= nKeys) && (n <= c.lastConsumed[n % nKeys]) ) {
+			c.nOutOfOrder++;
+		}
+		c.lastConsumed[n % nKeys] = n;
+		c.nConsumed++;
+	}});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, true, false, false);
+
+	int maxQueueLength = 0;
+	for (unsigned int update=0; update<nUpdates; update++) {
+		for (unsigned int key=0; key<nKeys; key++) {
+			myEvent.reportConflatedEvent(update*nKeys + key);
+			maxQueueLength = max(maxQueueLength, myEvent.getQueueLength());
+		}
+	}
+	BOOST_TEST(maxQueueLength <= (int)nKeys,                                "the queue depth should be bounded by the number of distinct keys");
+	BOOST_TEST(myEvent.getNumberOfConflatedEvents() >= nKeys*nUpdates - 2*nKeys - 1, "updates should have replaced their pending versions");
+	consumerGate.unlock();
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(c.nOutOfOrder == 0u,                                     "an older update was consumed after a newer one");
+	BOOST_TEST(c.nConsumed + myEvent.getNumberOfConflatedEvents() == nKeys*nUpdates);
+	for (unsigned int key=0; key<nKeys; key++) {
+		BOOST_TEST(c.lastConsumed[key] == (nUpdates-1)*nKeys + key,     "the latest update for key #"+to_string(key)+" was lost");
+	}
+
+	// multicast cursors may be reading any published event: no updates may be done in place
+	static constexpr unsigned int nMulticastUpdates = 8;
+	atomic_uint nMulticastConsumed(0);
+	atomic_uint nMulticastNotified(0);
+	consumerGate.lock();
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4> multicastEvent("conflation with multicast tests");
+	multicastEvent.setConflation([](const unsigned int& n) -> size_t { return n % nKeys; });
+	multicastEvent.setAnswerlessConsumer({[&consumerGate, &nMulticastConsumed](const unsigned int& n) {
+		if (nMulticastConsumed == 0) {
+			consumerGate.lock();
+			consumerGate.unlock();
+		}
+		nMulticastConsumed++;
+	}});
+	mutua::events::QueueEventDispatcher multicastEventDispatcher(multicastEvent, 1, 0, true, false, true, false, false);
+	mutua::events::MulticastDispatcher multicastListeners(multicastEvent, {[&nMulticastNotified](const unsigned int& n) { nMulticastNotified++; }});
+	for (unsigned int update=0; update<nMulticastUpdates; update++) {
+		multicastEvent.reportConflatedEvent(update*nKeys);
+	}
+	BOOST_TEST(multicastEvent.getNumberOfConflatedEvents() == 0u,        "events were updated in place while multicast cursors could be reading them");
+	consumerGate.unlock();
+	BOOST_TEST(multicastEventDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(multicastListeners.join() == nMulticastUpdates);
+	BOOST_TEST(nMulticastConsumed == nMulticastUpdates);
+	BOOST_TEST(nMulticastNotified == nMulticastUpdates);
+
+	HEAP_TRACE("conflation", output);
+}
+
+BOOST_AUTO_TEST_CASE(stateChannel) {
+	HEAP_MARK();
+
+	// a "load figure" whose fields must be read consistently
+	struct Load {
+		unsigned int version;
+		unsigned int doubledVersion;
+	};
+	static constexpr unsigned int nVersions = 100000;
+	static constexpr unsigned int nReaders  = 3;
+	atomic_uint nNotifications(0);
+	atomic_uint lastNotifiedVersion(0);
+	atomic_uint nTornReads(0);
+	mutua::events::StateChannel<Load> loadChannel("stateChannel tests", {0, 0}, {[&nNotifications, &lastNotifiedVersion](const Load& load) {
+		nNotifications++;
+		lastNotifiedVersion = load.version;
+	}});
+
+	thread readers[nReaders];
+	for (thread& reader : readers) {
+		reader = thread([&loadChannel, &nTornReads]() {
+			Load load;
+			while (!loadChannel.isClosed()) {
+				unsigned long long version = loadChannel.read(load);
+				if ( (load.doubledVersion != load.version*2) || (version != load.version) ) {
+					nTornReads++;
+				}
+			}
+		});
+	}
+	atomic_uint nChanges(0);
+	atomic_uint nBackwardChanges(0);
+	thread waiter([&loadChannel, &nChanges, &nBackwardChanges]() {
+		unsigned long long knownVersion = 0;
+		Load load;
+		while (loadChannel.waitForChange(knownVersion, load)) {
+			if (load.version != knownVersion) {
+				nBackwardChanges++;
+			}
+			nChanges++;
+		}
+	});
+
+	for (unsigned int v=1; v<=nVersions; v++) {
+		BOOST_REQUIRE(loadChannel.publish({v, v*2}) == v);
+	}
+	BOOST_TEST(loadChannel.getVersion() == nVersions);
+	// allow the notifier to catch up before closing
+	while (lastNotifiedVersion != nVersions) {
+		this_thread::yield();
+	}
+	loadChannel.close();
+	for (thread& reader : readers) {
+		reader.join();
+	}
+	waiter.join();
+
+	BOOST_TEST(nTornReads == 0u,                                        "readers saw a partially written state");
+	BOOST_TEST(nBackwardChanges == 0u,                                  "'waitForChange(...)' reported a stale version");
+	BOOST_TEST(nChanges >= 1u);
+	BOOST_TEST(nNotifications >= 1u);
+	BOOST_TEST(nNotifications <= nVersions,                             "listeners should be notified at most once per version");
+	BOOST_CHECK_THROW(loadChannel.publish({0, 0}), runtime_error);
+
+	HEAP_TRACE("stateChannel", output);
+}
+
+BOOST_AUTO_TEST_CASE(timingWheel) {
+	HEAP_MARK();
+
+	// one shot timers spanning more than one turn of the lowest level wheel, cancelled timers & a periodic one
+	static constexpr unsigned int nOneShots     = 1000;
+	static constexpr unsigned int nCancelled    = 100;
+	static constexpr unsigned int periodicEvent = 2000;
+	static constexpr unsigned int boundaryEvent = 3000;
+	struct {
+		chrono::steady_clock::time_point dueTimes[nOneShots];
+		atomic_uint                      nFired[nOneShots+nCancelled];
+		atomic_uint                      nEarly;
+		atomic_uint                      nPeriodic;
+		chrono::steady_clock::time_point boundaryFiringTime;
+		atomic_bool                      isBoundaryFired;
+	} c;
+	for (atomic_uint& nFired : c.nFired) {
+		nFired = 0;
+	}
+	c.nEarly    = 0;
+	c.nPeriodic = 0;
+	c.isBoundaryFired = false;
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 10> myEvent("timingWheel tests");
+	myEvent.setAnswerlessConsumer({[&c](const unsigned int& n) {
+		if (n == boundaryEvent) {
+			c.boundaryFiringTime = chrono::steady_clock::now();
+			c.isBoundaryFired    = true;
+			return;
+		}
+		if (n == periodicEvent) {
+			c.nPeriodic++;
+			return;
+		}
+		if ( (n < nOneShots) && (chrono::steady_clock::now() < c.dueTimes[n]) ) {
+			c.nEarly++;
+		}
+		c.nFired[n]++;
+	}});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, true, false, false);
+	mutua::events::TimingWheel timers(myEvent, chrono::milliseconds(1));
+
+	auto now = chrono::steady_clock::now();
+	for (unsigned int i=0; i<nOneShots; i++) {
+		c.dueTimes[i] = now + chrono::milliseconds((i*7) % 400);
+		if (i % 2 == 0) {
+			timers.reportEventAt(c.dueTimes[i], i);
+		} else {
+			timers.reportEventAfter(c.dueTimes[i] - chrono::steady_clock::now(), i);
+		}
+	}
+	for (unsigned int i=nOneShots; i<nOneShots+nCancelled; i++) {
+		auto timerId = timers.reportEventAfter(chrono::milliseconds(300), i);
+		BOOST_REQUIRE(timers.cancelTimer(timerId));
+		BOOST_REQUIRE(!timers.cancelTimer(timerId));
+	}
+	auto periodicTimerId = timers.reportPeriodicEvent(chrono::milliseconds(20), periodicEvent);
+	BOOST_TEST(timers.getNumberOfPendingTimers() == nOneShots+1);
+
+	// wait for all one shots to fire
+	for (unsigned int i=0; i<nOneShots; i++) {
+		while (c.nFired[i] == 0) {
+			BOOST_REQUIRE_MESSAGE(chrono::steady_clock::now() < now + chrono::seconds(10), "timer #"+to_string(i)+" never fired");
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+	}
+	BOOST_TEST(timers.cancelTimer(periodicTimerId));
+	BOOST_TEST(timers.getNumberOfPendingTimers() == 0u);
+	timers.stop();
+
+	// a timer due exactly when a higher level slot gets cascaded must fire on that very tick -- not on the next one
+	constexpr auto boundaryTick = chrono::milliseconds(20);
+	auto boundaryStart = chrono::steady_clock::now();
+	mutua::events::TimingWheel<decltype(myEvent), 6> boundaryTimers(myEvent, boundaryTick);	// 64 slots per level
+	boundaryTimers.reportEventAt(boundaryStart + 64*boundaryTick - boundaryTick/2, boundaryEvent);	// due on tick 64
+	while (!c.isBoundaryFired) {
+		BOOST_REQUIRE_MESSAGE(chrono::steady_clock::now() < boundaryStart + chrono::seconds(10), "the cascade boundary timer never fired");
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	boundaryTimers.stop();
+	BOOST_TEST((c.boundaryFiringTime >= boundaryStart + 64*boundaryTick - boundaryTick/2), "the cascade boundary timer fired early");
+	BOOST_TEST((c.boundaryFiringTime <  boundaryStart + 64*boundaryTick + boundaryTick/2), "the cascade boundary timer fired "+
+	           to_string(chrono::duration_cast<chrono::milliseconds>(c.boundaryFiringTime - boundaryStart).count())+"ms after the wheel started -- one tick late?");
+
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(c.nEarly == 0u,                                          "timers fired before their due times");
+	BOOST_TEST(c.nPeriodic >= 5u,                                       "the periodic timer fired only "+to_string(c.nPeriodic)+" times in ~400ms");
+	for (unsigned int i=0; i<nOneShots+nCancelled; i++) {
+		BOOST_REQUIRE_MESSAGE(c.nFired[i] == (i < nOneShots ? 1u : 0u), "timer #"+to_string(i)+" fired "+to_string(c.nFired[i])+" times");
+	}
+
+	HEAP_TRACE("timingWheel", output);
+}
+
+BOOST_AUTO_TEST_CASE(admissionControl) {
+	HEAP_MARK();
+
+	// 1000 events/s with bursts of 10: a tight loop of reports gets throttled right after the burst
+	static constexpr unsigned int nEvents = 50;
+	atomic_uint nDiverted(0);
+	mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("admissionControl tests");
+	myEvent.setAnswerlessConsumer({[this](const unsigned int& n) { answerlessConsumedEvents[n]++; }});
+	mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, true, false, false);
+	unsigned int* reservedParameterReference;
+
+	output("\tREJECT policy: ");
+	myEvent.setAdmissionControl(1000, 10, mutua::events::AdmissionPolicy::REJECT);
+	unsigned int nAdmitted = 0;
+	for (unsigned int i=0; i<nEvents; i++) try {
+		int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+		nAdmitted++;
+	} catch (const mutua::events::EventRejected& e) {}
+	output(to_string(nAdmitted)+" admitted; ");
+	BOOST_TEST(nAdmitted >= 10u,                                        "the burst should have been admitted");
+	BOOST_TEST(nAdmitted < nEvents,                                     "events above the rate should have been rejected");
+	BOOST_TEST(myEvent.getNumberOfRejectedEvents() == nEvents - nAdmitted);
+
+	output("DELAY policy: ");
+	myEvent.setAdmissionControl(1000, 10, mutua::events::AdmissionPolicy::DELAY);
+	auto start = chrono::steady_clock::now();
+	for (unsigned int i=nEvents; i<2*nEvents; i++) {
+		int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+	auto elapsed = chrono::steady_clock::now() - start;
+	output(to_string(chrono::duration_cast<chrono::milliseconds>(elapsed).count())+"ms; ");
+	BOOST_TEST(elapsed >= chrono::milliseconds(nEvents-10-1),           "reports above the burst should have been paced at the allowed rate");
+
+	output("DIVERT policy.\n");
+	myEvent.setAdmissionControl(1000, 10, mutua::events::AdmissionPolicy::DIVERT, [&nDiverted](const unsigned int& n) { nDiverted++; });
+	unsigned long long nRejectedBefore = myEvent.getNumberOfRejectedEvents();
+	for (unsigned int i=2*nEvents; i<3*nEvents; i++) {
+		int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+		*reservedParameterReference = i;
+		myEvent.reportReservedEvent(eventId);
+	}
+	BOOST_TEST(myDispatcher.stopWhenEmpty() == 0);
+	unsigned int nConsumed = 0;
+	for (unsigned int i=2*nEvents; i<3*nEvents; i++) {
+		BOOST_REQUIRE(answerlessConsumedEvents[i] <= 1u);
+		nConsumed += answerlessConsumedEvents[i];
+	}
+	BOOST_TEST(nDiverted > 0u);
+	BOOST_TEST(nConsumed + nDiverted == nEvents,                        "diverted events should not reach the consumer");
+	BOOST_TEST(myEvent.getNumberOfRejectedEvents() - nRejectedBefore == nDiverted);
+
+	HEAP_TRACE("admissionControl", output);
+}
+
+BOOST_AUTO_TEST_CASE(multiEventLink) {
+	HEAP_MARK();
+
+	// README's 'SERVER_REQUEST_EVENTS' spike, on a single ring
+	struct RequestStaticContent {
+		unsigned int requestId;
+		bool         allowCache;
+	};
+	struct RequestDynamicContent {
+		unsigned int requestId;
+		string       headers;
+		RequestDynamicContent(unsigned int requestId, string headers)
+				: requestId(requestId), headers(headers) {
+			if (headers.empty()) {
+				throw invalid_argument("dynamic content requests must have headers");
+			}
+		}
+	};
+	static constexpr unsigned int nEvents = 10000;
+	struct {
+		unsigned int nStaticRequests;
+		unsigned int nDynamicRequests;
+		unsigned int nMismatches;
+	} c = {0, 0, 0};
+	typedef mutua::events::MultiEventLink<10, 4, RequestStaticContent, RequestDynamicContent> ServerRequestsLink;
+	static_assert(sizeof(ServerRequestsLink::Event::storage) == max(sizeof(RequestStaticContent), sizeof(RequestDynamicContent)));
+	ServerRequestsLink serverRequests("multiEventLink tests");
+	serverRequests.setEventConsumer<RequestStaticContent>({[&c](const RequestStaticContent& request) {
+		if ( (request.requestId % 2 != 0) || (request.allowCache != (request.requestId % 4 == 0)) ) {
+			c.nMismatches++;
+		}
+		c.nStaticRequests++;
+	}});
+	serverRequests.setEventConsumer<RequestDynamicContent>({[&c](const RequestDynamicContent& request) {
+		if ( (request.requestId % 2 != 1) || (request.headers != "X-Request-Id: "+to_string(request.requestId)) ) {
+			c.nMismatches++;
+		}
+		c.nDynamicRequests++;
+	}});
+	mutua::events::QueueEventDispatcher serverDispatcher(serverRequests, 1, 0, true, false, true, false, false);
+
+	for (unsigned int i=0; i<nEvents; i++) {
+		if (i % 2 == 0) {
+			serverRequests.reportEvent<RequestStaticContent>(RequestStaticContent{i, i % 4 == 0});
+		} else {
+			serverRequests.reportEvent<RequestDynamicContent>(i, "X-Request-Id: "+to_string(i));
+		}
+	}
+
+	// events failing to be constructed must not wedge the link -- which has only 16 slots
+	for (unsigned int i=0; i<64; i++) {
+		BOOST_CHECK_THROW(serverRequests.reportEvent<RequestDynamicContent>(nEvents+i, ""), invalid_argument);
+	}
+	// neither may slots reported without an event, through the base link
+	ServerRequestsLink::Event* reservedEvent;
+	serverRequests.reportReservedEvent(serverRequests.reserveEventForReporting(reservedEvent));
+	serverRequests.reportEvent<RequestStaticContent>(RequestStaticContent{nEvents, true});
+
+	BOOST_TEST(serverDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(c.nStaticRequests  == nEvents/2 + 1);
+	BOOST_TEST(c.nDynamicRequests == nEvents/2);
+	BOOST_TEST(c.nMismatches == 0u,                                     "events were delivered to the wrong consumer or corrupted");
+
+	HEAP_TRACE("multiEventLink", output);
+}
+
+BOOST_AUTO_TEST_CASE(eventRegistry) {
+	HEAP_MARK();
+
+	static constexpr unsigned int nEvents = 1000;
+	typedef mutua::events::EventRegistry<MyEvents,
+	                                     mutua::events::EventRegistration<MyEvents::EventA, mutua::events::QueueEventLink<bool,         unsigned int, 10, 4>>,
+	                                     mutua::events::EventRegistration<MyEvents::EventB, mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 4>>,
+	                                     mutua::events::EventRegistration<MyEvents::EventC, mutua::events::QueueEventLink<bool,         string,       10, 4>>>
+	        MyEventsRegistry;
+	static_assert(MyEventsRegistry::nEvents == 3);
+	static_assert(std::is_same<MyEventsRegistry::LinkType<MyEvents::EventC>, mutua::events::QueueEventLink<bool, string, 10, 4>>::value);
+	MyEventsRegistry myEvents({"eventRegistry A tests", "eventRegistry B tests", "eventRegistry C tests"});
+
+	struct {
+		unsigned int       nA;
+		unsigned int       sumB;
+		unsigned int       nMismatchedC;
+	} c = {0, 0, 0};
+	myEvents.link<MyEvents::EventA>().setAnswerlessConsumer({[&c](const unsigned int& n) { c.nA++; }});
+	myEvents.link<MyEvents::EventB>().setAnswerlessConsumer({[&c](const unsigned int& n) { c.sumB += n; }});
+	myEvents.link<MyEvents::EventC>().setAnswerlessConsumer({[&c](const string& s)       { if (s != "C") c.nMismatchedC++; }});
+	mutua::events::QueueEventDispatcher dispatcherA(myEvents.link<MyEvents::EventA>(), 1, 0, true, false, true, false, false);
+	mutua::events::QueueEventDispatcher dispatcherB(myEvents.link<MyEvents::EventB>(), 1, 0, true, false, true, false, false);
+	mutua::events::QueueEventDispatcher dispatcherC(myEvents.link<MyEvents::EventC>(), 1, 0, true, false, true, false, false);
+
+	for (unsigned int i=0; i<nEvents; i++) {
+		myEvents.reportEvent<MyEvents::EventA>(i);
+		myEvents.reportEvent<MyEvents::EventB>(2u);
+		myEvents.reportEvent<MyEvents::EventC>("C"s);
+	}
+	BOOST_TEST(dispatcherA.stopWhenEmpty() == 0);
+	BOOST_TEST(dispatcherB.stopWhenEmpty() == 0);
+	BOOST_TEST(dispatcherC.stopWhenEmpty() == 0);
+	BOOST_TEST(c.nA == nEvents);
+	BOOST_TEST(c.sumB == nEvents * 2);
+	BOOST_TEST(c.nMismatchedC == 0u);
+
+	// shutdown & metrics over all links
+	string visitedEvents;
+	int totalQueueLength = 0;
+	myEvents.forEachLink([&visitedEvents, &totalQueueLength](MyEvents event, auto& link) {
+		visitedEvents    += to_string((int) event) + ":" + link.eventName + ";";
+		totalQueueLength += link.getQueueLength();
+	});
+	BOOST_TEST(visitedEvents == "0:eventRegistry A tests;1:eventRegistry B tests;2:eventRegistry C tests;");
+	BOOST_TEST(totalQueueLength == 0);
+
+	HEAP_TRACE("eventRegistry", output);
+}
+
+BOOST_AUTO_TEST_CASE(topicBus) {
+	HEAP_MARK();
+
+	typedef mutua::events::QueueEventLink<bool, unsigned int, 10, 8> OrdersLink;
+	static constexpr unsigned int nSubscribers = 4;
+	static constexpr unsigned int nPublishes   = 10000;
+	OrdersLink* subscriberLinks[nSubscribers];
+	mutua::events::QueueEventDispatcher<OrdersLink>* dispatchers[nSubscribers];
+	atomic_uint nReceived[nSubscribers];
+	for (unsigned int i=0; i<nSubscribers; i++) {
+		nReceived[i] = 0;
+		subscriberLinks[i] = new OrdersLink("topicBus subscriber #"+to_string(i)+" tests");
+		subscriberLinks[i]->setAnswerlessConsumer({[&nReceived, i](const unsigned int& n) { nReceived[i]++; }});
+		dispatchers[i] = new mutua::events::QueueEventDispatcher(*subscriberLinks[i], 1, 0, true, false, true, false, false);
+	}
+
+	mutua::events::TopicBus<OrdersLink> bus;
+	bus.subscribe("orders.eu.*", *subscriberLinks[0]);
+	bus.subscribe("orders.#",    *subscriberLinks[1]);
+	bus.subscribe("orders.*.fr", *subscriberLinks[2]);
+	bus.subscribe("orders.eu.fr", *subscriberLinks[2]);		// overlapping patterns of a subscriber should report only once
+	BOOST_CHECK_THROW(bus.subscribe("orders.#.fr", *subscriberLinks[3]), invalid_argument);
+
+	BOOST_TEST(bus.publish("orders.eu.fr", 1) == 3u);
+	BOOST_TEST(bus.publish("orders.eu.de", 2) == 2u);
+	BOOST_TEST(bus.publish("orders.us.fr", 3) == 2u);
+	BOOST_TEST(bus.publish("orders",       4) == 1u);
+	BOOST_TEST(bus.publish("orders.eu",    5) == 1u);
+	BOOST_TEST(bus.publish("quotes.eu.fr", 6) == 0u);
+	BOOST_TEST(bus.publish("orders.eu.fr.paris", 7) == 1u);
+
+	// subscriptions changing while publishing
+	atomic_bool isPublishing(true);
+	thread publisher([&bus, &isPublishing]() {
+		for (unsigned int i=0; i<nPublishes; i++) {
+			bus.publish("orders.eu.it", i);
+		}
+		isPublishing = false;
+	});
+	unsigned int nChanges = 0;
+	while (isPublishing) {
+		auto subscriptionId = bus.subscribe("*.eu.#", *subscriberLinks[3]);
+		this_thread::yield();
+		BOOST_REQUIRE(bus.unsubscribe(subscriptionId));
+		BOOST_REQUIRE(!bus.unsubscribe(subscriptionId));
+		nChanges++;
+	}
+	publisher.join();
+
+	for (unsigned int i=0; i<nSubscribers; i++) {
+		BOOST_TEST(dispatchers[i]->stopWhenEmpty() == 0);
+		delete dispatchers[i];
+	}
+	BOOST_TEST(nReceived[0] == 2u + nPublishes);
+	BOOST_TEST(nReceived[1] == 6u + nPublishes);
+	BOOST_TEST(nReceived[2] == 2u);
+	BOOST_TEST(nReceived[3] <= nPublishes,                              "the changing subscription got "+to_string(nReceived[3])+" events after "+to_string(nChanges)+" changes");
+	for (unsigned int i=0; i<nSubscribers; i++) {
+		delete subscriberLinks[i];
+	}
+
+	// fan-out robustness: closed subscribers, consumers publishing while running inline and publishers blocked on a full subscriber
+	typedef mutua::events::QueueEventLink<bool, unsigned int, 10, 4> TradesLink;
+	mutua::events::TopicBus<TradesLink> tradesBus;
+	TradesLink closedLink("topicBus closed subscriber tests");
+	TradesLink inlineLink("topicBus inline subscriber tests");
+	TradesLink auditLink("topicBus audit subscriber tests");
+	TradesLink gatedLink("topicBus gated subscriber tests");
+	atomic_uint nInlineReceived(0);
+	atomic_uint nAuditReceived(0);
+	atomic_uint nGatedReceived(0);
+	mutex gatedConsumerGate;
+	gatedConsumerGate.lock();
+	inlineLink.setAnswerlessConsumer({[&tradesBus, &nInlineReceived](const unsigned int& n) {
+		nInlineReceived++;
+		tradesBus.publish("audit", n);
+	}});
+	auditLink.setAnswerlessConsumer({[&nAuditReceived](const unsigned int& n) { nAuditReceived++; }});
+	gatedLink.setAnswerlessConsumer({[&gatedConsumerGate, &nGatedReceived](const unsigned int& n) {
+		gatedConsumerGate.lock();
+		gatedConsumerGate.unlock();
+		nGatedReceived++;
+	}});
+	closedLink.close();
+	mutua::events::QueueEventDispatcher inlineDispatcher(inlineLink, 1, 0, true, false, true, false, false);
+	inlineDispatcher.enableInlineWhenIdle();
+	mutua::events::QueueEventDispatcher auditDispatcher(auditLink, 1, 0, true, false, true, false, false);
+	mutua::events::QueueEventDispatcher gatedDispatcher(gatedLink, 1, 0, true, false, true, false, false);
+	tradesBus.subscribe("trades", closedLink);
+	tradesBus.subscribe("trades", inlineLink);
+	auto auditSubscriptionId = tradesBus.subscribe("#", auditLink);
+	tradesBus.subscribe("orders", gatedLink);
+
+	BOOST_TEST(tradesBus.publish("trades", 1) == 2u,                    "a closed subscriber should not keep the others from getting the event");
+	BOOST_TEST(tradesBus.getNumberOfFailedDeliveries() == 1u);
+
+	static constexpr unsigned int nGatedPublishes = 20;		// more than 'gatedLink' holds
+	thread blockedPublisher([&tradesBus]() {
+		for (unsigned int i=0; i<nGatedPublishes; i++) {
+			tradesBus.publish("orders", i);
+		}
+	});
+	for (int i=0; (i<5000) && (gatedLink.getQueueLength() < 15); i++) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	atomic_bool isUnsubscribed(false);
+	thread unsubscriber([&tradesBus, &isUnsubscribed, auditSubscriptionId]() {
+		tradesBus.unsubscribe(auditSubscriptionId);
+		isUnsubscribed = true;
+	});
+	for (int i=0; (i<1000) && (!isUnsubscribed); i++) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	BOOST_TEST(isUnsubscribed,                                          "a publisher blocked on a full subscriber held back the unsubscription of another one");
+	gatedConsumerGate.unlock();
+	unsubscriber.join();
+	blockedPublisher.join();
+
+	BOOST_TEST(inlineDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(auditDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(gatedDispatcher.stopWhenEmpty() == 0);
+	BOOST_TEST(nInlineReceived == 1u);
+	BOOST_TEST(nAuditReceived >= 2u,                                    "both the trade and its audit event, published by the inline consumer, should have been received");
+	BOOST_TEST(nGatedReceived == nGatedPublishes);
+
+	HEAP_TRACE("topicBus", output);
+}
+
+BOOST_AUTO_TEST_CASE(deterministicShutdown) {
+	HEAP_MARK();
+
+	// drain: queued events are consumed, reserved but unreported ones are reported as leftovers
+	{
+		mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("deterministicShutdown drain tests");
+		myEvent.setAnswerlessConsumer(&QueueEventLinkSuiteObjects::_answerlessEventConsumer, {(QueueEventLinkSuiteObjects*)this, (QueueEventLinkSuiteObjects*)this});
+		mutua::events::QueueEventDispatcher myDispatcher(myEvent, 2, 0, true, false, true, false, false);
+		unsigned int* reservedParameterReference;
+		for (unsigned int i=0; i<100; i++) {
+			unsigned int eventId = myEvent.reserveEventForReporting(reservedParameterReference);
+			*reservedParameterReference = i;
+			myEvent.reportReservedEvent(eventId);
+		}
+		myEvent.reserveEventForReporting(reservedParameterReference);	// never reported
+		unsigned long long start = TimeMeasurements::getMonotonicRealTimeUS();
+		unsigned int leftovers = myDispatcher.stopWhenEmpty();
+		unsigned long long finish = TimeMeasurements::getMonotonicRealTimeUS();
+		output("drain time: " + to_string(finish - start) + "µs\n");
+		BOOST_TEST(leftovers == 1, "reserved, but not reported, events should be reported as leftovers");
+		BOOST_TEST(answerlessConsumedEvents[99] == 1, "queued events must be consumed when draining");
+		BOOST_CHECK_THROW(myEvent.reserveEventForReporting(reservedParameterReference), runtime_error);
+	}
+
+	// stop ASAP: the running consumer finishes, waiters for queued answerfull events are woken up with an exception
+	{
+		mutex       consumerGate;
+		atomic_bool isConsuming(false);
+		consumerGate.lock();
+		mutua::events::QueueEventLink<unsigned int, unsigned int, 10, 8> myEvent("deterministicShutdown stopASAP tests");
+		myEvent.setAnswerfullConsumer({[&consumerGate, &isConsuming](const unsigned int& n, unsigned int* answer, std::mutex& answerMutex) {
+			isConsuming = true;
+			consumerGate.lock();
+			consumerGate.unlock();
+			*answer = n;
+			answerMutex.unlock();
+		}});
+		mutua::events::QueueEventDispatcher myDispatcher(myEvent, 1, 0, true, false, false, true, false);
+		unsigned int* reservedParameterReference;
+		unsigned int  answers[2] = {-1u, -1u};
+		unsigned int  eventIds[2];
+		for (unsigned int i=0; i<2; i++) {
+			eventIds[i] = myEvent.reserveEventForReporting(reservedParameterReference, &answers[i]);
+			*reservedParameterReference = i;
+			myEvent.reportReservedEvent(eventIds[i]);
+		}
+		bool wasWaiterWokenWithException = false;
+		thread waiter([&] {
+			try {
+				myEvent.waitForAnswer(eventIds[1]);
+			} catch (const runtime_error& e) {
+				wasWaiterWokenWithException = true;
+			}
+		});
+		while (!isConsuming) {
+			this_thread::yield();
+		}
+		thread gateOpener([&] {
+			this_thread::sleep_for(chrono::milliseconds(10));
+			consumerGate.unlock();
+		});
+		unsigned int leftovers = myDispatcher.stopASAP();
+		waiter.join();
+		gateOpener.join();
+		BOOST_TEST(answers[0] == 0,                "the event being consumed when 'stopASAP()' was called must be completed");
+		BOOST_TEST(leftovers == 1,                 "the queued event should be reported as leftover");
+		BOOST_TEST(wasWaiterWokenWithException,    "waiters for leftover events must be woken up with an exception");
+	}
+
+	HEAP_TRACE("deterministicShutdown", output);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 
@@ -1227,6 +2872,43 @@ BOOST_AUTO_TEST_CASE(procedureTemplateSpikes) {
 	output("r = " + to_string(r) + "\n");
 }
 
+BOOST_AUTO_TEST_CASE(eventDelegateFunctionSpikes) {
+	HEAP_MARK();
+	int r=19258499;
+	_r=1234;
+	mutua::events::EventDelegate<void(const int&)> delegate(indirectlyCallableMethod);
+	for (int p=0; p<numberOfPasses; p++) {
+		unsigned long long start = TimeMeasurements::getMonotonicRealTimeUS();
+		for (unsigned int i=0; i<numberOfCalls; i++) {
+			delegate(r);
+			r ^= _r;
+		}
+		unsigned long long finish = TimeMeasurements::getMonotonicRealTimeUS();
+		output("eventDelegateFunctionSpikes Pass " + to_string(p) + " execution time: " + to_string(finish - start) + "µs\n");
+	}
+	HEAP_TRACE("eventDelegateFunctionSpikes", output);
+	output("r = " + to_string(r) + "\n");
+}
+
+BOOST_AUTO_TEST_CASE(eventDelegateLambdaSpikes) {
+	HEAP_MARK();
+	int r=19258499;
+	_r=1234;
+	int* rp = &r;
+	mutua::events::EventDelegate<void(const int&)> delegate([rp](const int& p1) { _r ^= p1; });
+	for (int p=0; p<numberOfPasses; p++) {
+		unsigned long long start = TimeMeasurements::getMonotonicRealTimeUS();
+		for (unsigned int i=0; i<numberOfCalls; i++) {
+			delegate(*rp);
+			r ^= _r;
+		}
+		unsigned long long finish = TimeMeasurements::getMonotonicRealTimeUS();
+		output("eventDelegateLambdaSpikes Pass " + to_string(p) + " execution time: " + to_string(finish - start) + "µs\n");
+	}
+	HEAP_TRACE("eventDelegateLambdaSpikes", output);
+	output("r = " + to_string(r) + "\n");
+}
+
 BOOST_AUTO_TEST_CASE(directEventLinkSpikes) {
 	HEAP_MARK();
 	int r=19258499;